@@ -104,6 +104,75 @@ public:
         return ret;
     }
 
+    /**
+     * Random access iterator over the available bytes, which reads them without consuming them,
+     * for example to inspect a message through a MessageView before deciding what to do with it.
+     * It is meant to be used by the consumer of the buffer, since it relies on the beginning not to move.
+     */
+    class PeekIterator {
+    public:
+        PeekIterator(const CircularBuffer* buffer, size_t index) : _buffer(buffer), _index(index) {}
+
+        inline bool operator==(const PeekIterator& other) const { return _index == other._index; }
+        inline bool operator!=(const PeekIterator& other) const { return _index != other._index; }
+
+        inline uint8_t operator*() const {
+            return _buffer->_buf.data[_index % _buffer->_capacity];
+        }
+
+        inline PeekIterator& operator++() {
+            ++_index;
+            return *this;
+        }
+
+        inline PeekIterator operator++(int) {
+            return PeekIterator(_buffer, _index++);
+        }
+
+        inline PeekIterator operator+(size_t n) const {
+            return PeekIterator(_buffer, _index + n);
+        }
+
+        inline ptrdiff_t operator-(const PeekIterator& other) const {
+            return _index - other._index;
+        }
+
+    private:
+        const CircularBuffer* _buffer;
+        size_t _index; // Not wrapped, so that the end can be distinguished from the beginning of a full buffer
+    };
+
+    inline PeekIterator peekBegin() const {
+        size_t start;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            start = _start;
+        }
+        return PeekIterator(this, start);
+    }
+
+    inline PeekIterator peekEnd() const {
+        size_t start, available;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            start = _start;
+            available = _available();
+        }
+        return PeekIterator(this, start + available);
+    }
+
+    /** Discards n bytes, for example after having inspected them. */
+    inline CircularBuffer& skip(size_t n) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (n > _available()) {
+                abort();
+            }
+            if (n > 0) {
+                _start = (_start + n) % _capacity;
+                _full = false;
+            }
+        }
+        return *this;
+    }
+
 private:
     const size_t _capacity;
     volatile detail::CircularBufferStorage<N> _buf;
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <inttypes.h>
+
+namespace avr {
+
+class HardwareSerial;
+
+/**
+ * Events published by the interrupt handlers of the library.
+ * Handlers receive them by const reference, and may write through the reference members to give a result back.
+ */
+namespace events {
+
+/** Timer2 overflow of Clock, roughly every millisecond. */
+struct ClockTick {
+    uint64_t millis;
+};
+
+/** A byte was received without errors, after being stored in the read buffer (if it was not full). */
+struct SerialReceived {
+    HardwareSerial& serial;
+    uint8_t data;
+};
+
+/** The write buffer has been completely transmitted. */
+struct SerialWriteBufferEmpty {
+    HardwareSerial& serial;
+};
+
+/** The I2C master sent a byte to this slave. */
+struct I2CDataReceived {
+    uint8_t data;
+};
+
+/** The I2C master is requesting a byte from this slave, which is the final value of data. */
+struct I2CDataRequested {
+    uint8_t& data;
+};
+
+} // namespace events
+
+
+
+/**
+ * Compile-time list of the handlers of an event, which are functions or static member functions
+ * taking the event by const reference.
+ * Handlers are called in order with direct calls, so they can be inlined in the publisher.
+ */
+template <auto... Handlers>
+struct subscriber_list {
+    static constexpr size_t size = sizeof...(Handlers);
+
+    template <auto Handler> using append = subscriber_list<Handlers..., Handler>;
+
+    template <typename Event>
+    static inline void publish(const Event& event) {
+        (Handlers(event), ...);
+    }
+};
+
+/** Subscribers of an event, none by default. Specialize it to subscribe handlers to an event. */
+template <typename Event>
+struct subscribers {
+    using type = subscriber_list<>;
+};
+
+/** Calls all the subscribers of the event. Without subscribers, it does not generate any code. */
+template <typename Event>
+inline void publish(const Event& event) {
+    subscribers<Event>::type::publish(event);
+}
+
+} // namespace avr
+
+
+
+/*
+ * The subscribers of the events published by the library must be visible when the library is compiled,
+ * so they are declared in a header set through the AVR_UTILS_EVENTS_CONFIG CMake variable:
+ *
+ *     // events.hpp
+ *     #include <avr-utils/Events.hpp>
+ *
+ *     inline void blink(const avr::events::ClockTick& e) { ... }
+ *     inline void log(const avr::events::ClockTick& e) { ... }
+ *
+ *     template <> struct avr::subscribers<avr::events::ClockTick> {
+ *         using type = avr::subscriber_list<blink, log>;
+ *     };
+ *
+ *     // CMakeLists.txt
+ *     set (AVR_UTILS_EVENTS_CONFIG ${CMAKE_CURRENT_SOURCE_DIR}/src/events.hpp)
+ *     add_subdirectory (lib/avr-utils)
+ */
+#ifdef AVR_UTILS_EVENTS_CONFIG
+#include AVR_UTILS_EVENTS_CONFIG
+#endif
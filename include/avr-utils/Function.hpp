@@ -1,52 +1,99 @@
 #pragma once
 
+#include <stdlib.h>
+
 #include "avr-utils/utility.hpp"
 
 namespace avr {
 
-template <typename>
+/** Default capacity of a Function, enough for an object pointer and a member function pointer. */
+static constexpr size_t defaultFunctionCapacity = 3 * sizeof(void*);
+
+template <typename, size_t Capacity = defaultFunctionCapacity>
 class Function;
 
-/** Container for callable objects. Can store either free functions or member functions. */
-template <typename TReturn, typename... TArgs>
-class Function<TReturn(TArgs...)> {
+/**
+ * Container for callable objects: free functions, member functions and lambdas, including the ones with captures.
+ * The callable is stored inline in a buffer of the given capacity, without any heap allocation,
+ * and is invoked through a single indirect call.
+ * Only trivially copyable callables are supported, so that functions can be copied around freely,
+ * even from interrupt handlers.
+ */
+template <typename TReturn, typename... TArgs, size_t Capacity>
+class Function<TReturn(TArgs...), Capacity> {
 public:
 
+    /** Constructs an empty function, which must not be invoked. */
+    Function()
+        : _invoke(&invokeEmpty)
+    {
+    }
+
     /** Constructs a function object from a free function. */
     Function(TReturn (*f)(TArgs...))
-        : _obj(nullptr),
-          _f_free(f)
+        : Function()
     {
+        if (f != nullptr) {
+            store(f);
+        }
     }
 
     /** Constructs a function object from a pointer to an object and a member pointer. */
     template <typename TObject>
     Function(TObject* obj, TReturn (TObject::*f)(TArgs...))
-        : _obj(reinterpret_cast<Dummy*>(obj)),
-          _f_member(reinterpret_cast<MemberFunction>(f))
     {
+        store([obj, f](TArgs... args) -> TReturn {
+            return (obj->*f)(forward<TArgs>(args)...);
+        });
+    }
+
+    /** Constructs a function object from any other callable object, like a lambda. */
+    template <
+        typename F,
+        typename = enable_if_t<!is_same_v<remove_cv_t<remove_reference_t<F>>, Function>>,
+        typename = decltype(declval<F&>()(declval<TArgs>()...))
+    >
+    Function(F&& f)
+    {
+        store(forward<F>(f));
     }
 
     TReturn operator()(TArgs... args) const {
-        if (_obj == nullptr) {
-            return _f_free(forward<TArgs>(args)...);
-        } else {
-            return (_obj->*_f_member)(forward<TArgs>(args)...);
-        }
+        return _invoke(const_cast<Storage*>(&_storage), forward<TArgs>(args)...);
+    }
+
+    explicit operator bool() const {
+        return _invoke != &invokeEmpty;
     }
 
 private:
 
-    class Dummy;
+    using Storage = typename aligned_storage<Capacity, alignof(void*)>::type;
+    using Invoker = TReturn (*)(Storage*, TArgs...);
+
+    Invoker _invoke;
+    Storage _storage;
 
-    using MemberFunction = TReturn (Dummy::* const)(TArgs...);
-    using FreeFunction = TReturn (* const)(TArgs...);
+    template <typename F>
+    inline void store(F&& f) {
+        using T = remove_cv_t<remove_reference_t<F>>;
 
-    Dummy* const _obj;
-    union {
-        MemberFunction _f_member;
-        FreeFunction _f_free;
-    };
+        static_assert(sizeof(T) <= Capacity, "The callable object is too big for the capacity of the function.");
+        static_assert(alignof(T) <= alignof(Storage), "The callable object is over-aligned.");
+        static_assert(is_trivially_copyable_v<T>, "Only trivially copyable callable objects are supported.");
+
+        new (&_storage) T(forward<F>(f));
+        _invoke = &invokeStored<T>;
+    }
+
+    template <typename T>
+    static TReturn invokeStored(Storage* storage, TArgs... args) {
+        return (*reinterpret_cast<T*>(storage))(forward<TArgs>(args)...);
+    }
+
+    static TReturn invokeEmpty(Storage*, TArgs...) {
+        abort();
+    }
 };
 
 } // namespace
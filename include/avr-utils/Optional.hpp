@@ -120,7 +120,7 @@ public:
     }
 
 private:
-    bool _active;
+    bool _active = false;
     typename aligned_storage<sizeof(T), alignof(T)>::type _storage;
 
     inline constexpr T* ptr() {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <util/atomic.h>
+
 #include "avr-utils/private/common.hpp"
 #include "avr-utils/utility.hpp"
 #include "avr-utils/Timer.hpp"
@@ -35,22 +37,98 @@ private:
 
 
 
+/** Collects the timers attached to the bits of a mask, without duplicates. */
+template <Port P, uint8_t Mask, uint8_t N = 0, typename Timers = list<>, typename = void>
+struct timers_for_mask {
+    using type = typename timers_for_mask<P, Mask, N + 1, Timers>::type;
+};
+
+template <Port P, uint8_t Mask, uint8_t N, typename Timers>
+struct timers_for_mask<P, Mask, N, Timers, enable_if_t<(N < 8) && (Mask & (1 << N)) != 0>> {
+    using timer = typename timer_for_pin<P, 1 << N>::timer;
+    using type = typename timers_for_mask<P, Mask, N + 1, typename Timers::template append_unique<timer>>::type;
+};
+
+template <Port P, uint8_t Mask, typename Timers>
+struct timers_for_mask<P, Mask, 8, Timers> {
+    using type = Timers;
+};
+
+
+
+/** Merges some lists of timers, without duplicates. */
+template <typename L, typename... Ls>
+struct merge_timers {
+    using type = L;
+};
+
+template <typename L, typename T, typename... Ts, typename... Ls>
+struct merge_timers<L, list<T, Ts...>, Ls...> {
+    using type = typename merge_timers<typename L::template append_unique<T>, list<Ts...>, Ls...>::type;
+};
+
+template <typename L, typename... Ls>
+struct merge_timers<L, list<>, Ls...> {
+    using type = typename merge_timers<L, Ls...>::type;
+};
+
+
+
+/** Runs f with all the timers of the given list halted. */
+template <typename... Timers, typename F>
+static inline void with_timers_halted(list<Timers...>, F&& f) {
+    withTimersHalted<Timers::index...>(forward<F>(f));
+}
+
+/**
+ * Initializes the given timers to drive PWM pins: 8 bit Fast PWM with prescaler 64.
+ * When there is more than one timer, they are also restarted at the same time,
+ * so that all of them reach TOP (and latch the new compare values) in the same clock cycle.
+ */
+template <typename Timers>
+static inline void init_pwm_timers() {
+    auto configure = [](auto t) {
+        using T = decltype(t);
+        T::template configure<T::pwmMode, TimerPrescaler::By64>();
+    };
+
+    if constexpr (Timers::size < 2) {
+        Timers::for_each(configure);
+    } else {
+        with_timers_halted(Timers(), [configure]() {
+            Timers::for_each(configure);
+            Timers::for_each([](auto t) {
+                decltype(t)::setCounterValue(0);
+            });
+        });
+    }
+}
+
+
+
 /** Common digital I/O on a port. */
 template <Port P, uint8_t Mask, PinMode Mode>
 class digital_io_port {
 
     using Traits = port_traits<P>;
 
-    struct initialize_timer_for_pwm {
-        template <uint8_t i>
-        inline void operator()() {
-            // Initialize the corresponding timer to Fast PWM with prescaler 64
-            using T = typename timer_for_pin<P, 1 << i>::timer;
-            T::template setMode<TimerMode::FastPWM>();
-            T::template setPrescaler<TimerPrescaler::By64>();
+    // Bit operations on a single pin compile to sbi/cbi, which are atomic, while operations on more
+    // pins need a read-modify-write of the register, which must be protected from interrupts
+    static constexpr bool isSingleBit = (Mask & (Mask - 1)) == 0;
+
+    template <typename F>
+    __attribute__((always_inline))
+    static inline void atomicUpdate(F&& f) {
+        if constexpr (isSingleBit) {
+            f();
+        } else {
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                f();
+            }
         }
-    };
+    }
 
+    template <bool Buffered>
     struct update_pwm_value {
 
         update_pwm_value(uint8_t v)
@@ -64,8 +142,10 @@ class digital_io_port {
             using T = typename timer_for_pin<P, mask>::timer;
             constexpr auto channel = timer_for_pin<P, mask>::channel;
 
-            // Handle the spacific 0% and 100% duty cicles as common digital writes
-            if (_value == 0 || _value == 255) {
+            // Handle the spacific 0% and 100% duty cicles as common digital writes.
+            // Changes to the outputs are immediate, while the compare registers are latched only at TOP,
+            // so buffered updates leave 100% to the compare unit (OCR = TOP gives a constant high output).
+            if (_value == 0 || (!Buffered && _value == 255)) {
                 T::template stopOutput<channel>();
                 if (_value == 0) {
                     Traits::outputRegister() &= ~mask;
@@ -82,33 +162,73 @@ class digital_io_port {
         const uint8_t _value;
     };
 
+    struct update_pwm16_value {
+
+        update_pwm16_value(uint16_t v)
+            : _value(v)
+        {
+        }
+
+        template <uint8_t i>
+        inline void operator()() {
+            constexpr auto mask = 1 << i;
+            using T = typename timer_for_pin<P, mask>::timer;
+            constexpr auto channel = timer_for_pin<P, mask>::channel;
+            static_assert(sizeof(typename T::ValueType) > 1, "16 bit PWM is only available on pins attached to a 16 bit timer.");
+
+            // A compare value equal to TOP already gives a constant high output,
+            // so only the 0% duty cycle needs to be handled as a digital write
+            if (_value == 0) {
+                T::template stopOutput<channel>();
+                Traits::outputRegister() &= ~mask;
+            } else {
+                T::template startOutput<channel>();
+                T::template setOutputCompareValue<channel>(_value);
+            }
+        }
+
+    private:
+        const uint16_t _value;
+    };
+
 public:
 
     static constexpr auto port = P;
     static constexpr auto mask = Mask;
     static constexpr auto mode = Mode;
 
+    /** Timers used by the pins in PWM mode. This fails if one of the pins has no attached timer. */
+    using timers = typename conditional_t<
+        Mode == PinMode::PWM,
+        timers_for_mask<P, Mask>,
+        identity<list<>>
+    >::type;
+
     // Pin initialization
 
+    /** Initializes only the pins, leaving the attached timers untouched. */
+    __attribute__((always_inline))
+    static inline void initPins() {
+        atomicUpdate([]() {
+            if constexpr (Mode == PinMode::Output) {
+                Traits::dataDirectionRegister() |= Mask;
+            } else if constexpr (Mode == PinMode::Input) {
+                Traits::dataDirectionRegister() &= ~Mask;
+            } else if constexpr (Mode == PinMode::InputPullup) {
+                Traits::dataDirectionRegister() &= ~Mask;
+                Traits::outputRegister() |= Mask; // Enable the pullup by default
+            } else if constexpr (Mode == PinMode::PWM) {
+                Traits::dataDirectionRegister() |= Mask;
+            }
+        });
+    }
+
     __attribute__((always_inline))
     static inline void init() {
-        if constexpr (Mode == PinMode::Output) {
-            Traits::dataDirectionRegister() |= Mask;
-        } else if constexpr (Mode == PinMode::Input) {
-            Traits::dataDirectionRegister() &= ~Mask;
-        } else if constexpr (Mode == PinMode::InputPullup) {
-            Traits::dataDirectionRegister() &= ~Mask;
-            Traits::outputRegister() |= Mask; // Enable the pullup by default
-        } else if constexpr (Mode == PinMode::PWM) {
-            
-            // Set the direction to output
-            Traits::dataDirectionRegister() |= Mask;
-
-            // Initialize the corresponding timer to Fast PWM with prescaler 64.
-            // This fails if this pin has no attached timer.
-            bitmask_iterator<Mask>::run(initialize_timer_for_pwm{});
-            
-        }
+        initPins();
+
+        // Initialize the corresponding timers, each one only once even if it drives more than one pin
+        init_pwm_timers<timers>();
     }
 
     // Digital read
@@ -119,31 +239,76 @@ public:
         return (Traits::inputRegister() & Mask) != 0;
     }
 
+    /** Reads all the pins at once, returning their bits in the same positions they have in the port. */
+    __attribute__((always_inline))
+    static inline uint8_t readPort() {
+        static_assert(Mode == PinMode::Input || Mode == PinMode::InputPullup);
+        return Traits::inputRegister() & Mask;
+    }
+
     // Digital write
 
     __attribute__((always_inline))
     static inline void set() {
         static_assert(Mode == PinMode::Output);
-        Traits::outputRegister() |= Mask;
+        atomicUpdate([]() {
+            Traits::outputRegister() |= Mask;
+        });
     }
 
     __attribute__((always_inline))
     static inline void unset() {
         static_assert(Mode == PinMode::Output);
-        Traits::outputRegister() &= ~Mask;
+        atomicUpdate([]() {
+            Traits::outputRegister() &= ~Mask;
+        });
     }
 
     __attribute__((always_inline))
     static inline void toggle() {
         static_assert(Mode == PinMode::Output);
-        Traits::outputRegister() ^= Mask;
+
+        // Writing a one to PINx toggles the pin in a single cycle, without any read-modify-write
+        Traits::inputRegister() = Mask;
+    }
+
+    /** Writes all the pins at once, taking their bits from the same positions they have in the port. */
+    __attribute__((always_inline))
+    static inline void writePort(uint8_t bits) {
+        static_assert(Mode == PinMode::Output);
+        if constexpr (Mask == 0xFF) {
+            Traits::outputRegister() = bits;
+        } else {
+            // Writing a one to PINx toggles the pin, so this changes only the bits that differ
+            // without touching the other pins of the port, even if an interrupt modifies them meanwhile
+            Traits::inputRegister() = (Traits::outputRegister() ^ bits) & Mask;
+        }
     }
 
     // PWM
 
     static inline void PWM(uint8_t value) {
         static_assert(Mode == PinMode::PWM);
-        bitmask_iterator<Mask>::run(update_pwm_value{ value });
+        bitmask_iterator<Mask>::run(update_pwm_value<false>{ value });
+    }
+
+    /**
+     * Like PWM, but the new duty cycle is applied by the hardware at the next TOP of the timer, like any other
+     * compare value, instead of immediately. The only exception is 0%, which needs to disconnect the output.
+     */
+    static inline void bufferedPWM(uint8_t value) {
+        static_assert(Mode == PinMode::PWM);
+        bitmask_iterator<Mask>::run(update_pwm_value<true>{ value });
+    }
+
+    /**
+     * 16 bit PWM for the pins attached to a 16 bit timer.
+     * The duty cycle is relative to the TOP of the current mode of the timer, so to get the full resolution
+     * at an arbitrary frequency switch the timer to TimerMode::FastPWMICR and set TOP with setInputCaptureValue.
+     */
+    static inline void PWM16(uint16_t value) {
+        static_assert(Mode == PinMode::PWM);
+        bitmask_iterator<Mask>::run(update_pwm16_value{ value });
     }
 
 };
@@ -216,6 +381,7 @@ using Pin = detail::digital_io_port<Port, 1 << N, Mode>;
 /**
  * Group of pins to optimize collective operations.
  * Can also hold pins of different ports and modes, but only writes can be performed on them as a group.
+ * The pins can also be read or written in parallel as the bits of a single value, e.g. to drive a data bus.
  */
 template <typename... Pins>
 class PinGroup {
@@ -225,12 +391,63 @@ class PinGroup {
 
 public:
 
+    /** All the timers used by the PWM pins of the group. */
+    using timers = typename detail::merge_timers<list<>, typename Pins::timers...>::type;
+
     // Initialization
 
+    /**
+     * Initializes all the pins.
+     * The timers used by PWM pins are initialized only once, and restarted at the same time so that their
+     * PWM cycles are aligned. Note that this resets their counters, including Timer2 used by Clock.
+     */
     __attribute__((always_inline))
     static inline void init() {
         groups::for_each([](auto x) {
-            decltype(x)::init();
+            decltype(x)::initPins();
+        });
+
+        detail::init_pwm_timers<timers>();
+    }
+
+    // Parallel read and write
+
+    /** Type able to hold one bit for each pin of the group, up to 32 pins. */
+    using ValueType = conditional_t<
+        (sizeof...(Pins) <= 8),
+        uint8_t,
+        conditional_t<(sizeof...(Pins) <= 16), uint16_t, uint32_t>
+    >;
+
+    /**
+     * Reads all the input pins of the group as a single value, where the i-th pin is the i-th bit.
+     * Each port is read only once.
+     */
+    __attribute__((always_inline))
+    static inline ValueType read() {
+        static_assert(((Pins::mode == PinMode::Input || Pins::mode == PinMode::InputPullup) && ...), "All the pins must be inputs.");
+        static_assert(sizeof...(Pins) <= 32, "At most 32 pins fit in a single value.");
+
+        ValueType value = 0;
+        groups::for_each([&value](auto x) {
+            using Group = decltype(x);
+            value |= fromPort<Group>(Group::readPort(), make_index_sequence<sizeof...(Pins)>());
+        });
+        return value;
+    }
+
+    /**
+     * Writes all the output pins of the group from a single value, where the i-th bit goes to the i-th pin.
+     * All the pins of the same port are written at once.
+     */
+    __attribute__((always_inline))
+    static inline void write(ValueType value) {
+        static_assert(((Pins::mode == PinMode::Output) && ...), "All the pins must be outputs.");
+        static_assert(sizeof...(Pins) <= 32, "At most 32 pins fit in a single value.");
+
+        groups::for_each([value](auto x) {
+            using Group = decltype(x);
+            Group::writePort(toPort<Group>(value, make_index_sequence<sizeof...(Pins)>()));
         });
     }
 
@@ -265,6 +482,141 @@ public:
         });
     }
 
+    static inline void PWM16(uint16_t value) {
+        groups::for_each([value](auto x) {
+            decltype(x)::PWM16(value);
+        });
+    }
+
+    /** Stages a new duty cycle for the N-th pin of the group, which is applied only by commitPWM. */
+    template <size_t N>
+    static inline void stagePWM(uint8_t value) {
+        static_assert(type_at_t<N, Pins...>::mode == PinMode::PWM, "The pin must be in PWM mode.");
+        _staged[N] = value;
+    }
+
+    /**
+     * Applies all the staged duty cycles at once.
+     * The timers of the group are halted while the compare registers are written, so that none of them can
+     * reach TOP in the middle of the update: the hardware then latches the new values at the next cycle,
+     * which is the same for all the channels since init() aligned the timers.
+     *
+     * Outputs entering or leaving the 0% duty cycle are connected or disconnected while the timers are halted too,
+     * so all of them switch at the same instant, but it is the instant of the commit rather than the next cycle:
+     * the cycle in progress of those channels may be cut short, or run with the previous compare value.
+     *
+     *     using Leds = PinGroup<Pin<Port::D, 6, PinMode::PWM>, Pin<Port::D, 5, PinMode::PWM>>;
+     *     Leds::init();
+     *
+     *     Leds::stagePWM<0>(200); // Both outputs are connected on the first commit
+     *     Leds::stagePWM<1>(50);
+     *     Leds::commitPWM();
+     *
+     *     Leds::stagePWM<0>(0);   // The first output is disconnected, and the second one changes duty cycle
+     *     Leds::stagePWM<1>(120);
+     *     Leds::commitPWM();
+     *
+     * Halting resets the prescalers of the timers (shared by Timer0 and Timer1), so each commit stretches
+     * the current cycle by up to one timer tick, and delays Clock::millis() as much when Timer2 is in the group.
+     */
+    static inline void commitPWM() {
+        static_assert(timers::size > 0, "The group has no PWM pins.");
+        using Indices = make_index_sequence<sizeof...(Pins)>;
+
+        detail::with_timers_halted(timers(), []() {
+            commit(Indices());
+        });
+    }
+
+private:
+
+    static inline uint8_t _staged[sizeof...(Pins)] = {};
+
+    template <typename Pin, typename Group>
+    static constexpr bool belongsTo = Pin::port == Group::port && Pin::mode == Group::mode;
+
+    static constexpr int bitIndex(uint8_t mask) {
+        return mask == 1 ? 0 : 1 + bitIndex(mask >> 1);
+    }
+
+    static constexpr int noShift = 0x7F;
+
+    /**
+     * If the pins of a port keep the same order and spacing they have in the group,
+     * returns the shift between the two, so that the whole port can be mapped with a single shift.
+     */
+    template <typename Group>
+    static constexpr int shiftFor() {
+        constexpr bool inGroup[] = { belongsTo<Pins, Group>... };
+        constexpr int bits[] = { bitIndex(Pins::mask)... };
+
+        bool found = false;
+        int shift = 0;
+        for (size_t i = 0; i < sizeof...(Pins); ++i) {
+            if (inGroup[i]) {
+                if (!found) {
+                    shift = bits[i] - (int) i;
+                    found = true;
+                } else if (shift != bits[i] - (int) i) {
+                    return noShift;
+                }
+            }
+        }
+        return shift;
+    }
+
+    template <typename Group, size_t... Is>
+    static inline uint8_t toPort(ValueType value, index_sequence<Is...>) {
+        constexpr int shift = shiftFor<Group>();
+        if constexpr (shift == noShift) {
+            uint8_t bits = 0;
+            ([&bits, value]() {
+                if constexpr (belongsTo<type_at_t<Is, Pins...>, Group>) {
+                    if (value & ((ValueType) 1 << Is)) {
+                        bits |= type_at_t<Is, Pins...>::mask;
+                    }
+                }
+            }(), ...);
+            return bits;
+        } else if constexpr (shift >= 0) {
+            return (uint8_t) (value << shift) & Group::mask;
+        } else {
+            return (uint8_t) (value >> -shift) & Group::mask;
+        }
+    }
+
+    template <typename Group, size_t... Is>
+    static inline ValueType fromPort(uint8_t bits, index_sequence<Is...>) {
+        constexpr int shift = shiftFor<Group>();
+        if constexpr (shift == noShift) {
+            ValueType value = 0;
+            ([&value, bits]() {
+                if constexpr (belongsTo<type_at_t<Is, Pins...>, Group>) {
+                    if (bits & type_at_t<Is, Pins...>::mask) {
+                        value |= (ValueType) 1 << Is;
+                    }
+                }
+            }(), ...);
+            return value;
+        } else if constexpr (shift >= 0) {
+            return (ValueType) bits >> shift;
+        } else {
+            return (ValueType) bits << -shift;
+        }
+    }
+
+    template <size_t... Is>
+    static inline void commit(index_sequence<Is...>) {
+        (commit<type_at_t<Is, Pins...>>(_staged[Is]), ...);
+    }
+
+    template <typename Pin>
+    static inline void commit(uint8_t value) {
+        if constexpr (Pin::mode == PinMode::PWM) {
+            Pin::bufferedPWM(value);
+        }
+    }
+
 };
 
 } // namespace avr
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <avr/interrupt.h>
 
 #include "avr-utils/CircularBuffer.hpp"
+#include "avr-utils/StreamIterator.hpp"
 
 #ifndef F_CPU
 #error "F_CPU must be defined."
@@ -91,6 +92,17 @@ protected:
 };
 
 
+/**
+ * Serial streams never end when used through StreamWriter and StreamReader:
+ * writes wait for space in the buffer, applying backpressure, and reads wait for the data to be received.
+ */
+template <>
+struct stream_traits<Serial> {
+    static inline bool canWrite(Serial&) { return true; }
+    static inline bool canRead(Serial&) { return true; }
+};
+
+
 /** Uses the hardware implementation of UART to provide a user-friendly buffered serial stream. */
 class HardwareSerial final : public Serial {
 public:
@@ -134,6 +146,17 @@ private:
 };
 
 
+/**
+ * Traits lookup is by exact type, so the hardware serials need their own specialization
+ * to be used directly with StreamWriter and StreamReader:
+ *
+ *     StreamWriter<HardwareSerial> it(Serial0), end;
+ *     DateTime::Serializer::serialize(now, it, end);
+ */
+template <>
+struct stream_traits<HardwareSerial> : stream_traits<Serial> {};
+
+
 
 // Provide an already instantiated HardwareSerial object for all the serials natively available on the mcu.
 #ifdef SERIAL_HAVE_SERIAL0
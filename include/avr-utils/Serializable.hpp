@@ -7,110 +7,204 @@
 
 namespace avr {
 
-template <auto T>
+/** Wire encodings for the integer fields. */
+enum class FieldEncoding {
+    BigEndian,
+    LittleEndian,
+    Varint // LEB128, with zigzag encoding for signed integers
+};
+
+template <auto T, FieldEncoding Encoding = FieldEncoding::BigEndian>
 struct Field;
 
 
 
+/** Value of fixedSize for the serializers whose output size depends on the values. */
+static constexpr size_t variableSize = (size_t) -1;
+
+
+
 namespace __detail {
 
 template <typename T, typename Enable = void>
 struct ValueSerializer;
 
-template <>
-struct ValueSerializer<uint8_t> {
-    
-    template <typename TIter>
-    inline static Optional<size_t> deserialize(uint8_t* value, TIter&& it, TIter&& end) {
-        if (it == end) {
-            return nullopt;
+/** Sums the fixed sizes of a sequence of serializers, which is fixed only if all of them are. */
+template <typename... Sizes>
+constexpr size_t sum_fixed_sizes(Sizes... sizes) {
+    const size_t all[] = { (size_t) 0, (size_t) sizes... };
+    size_t total = 0;
+    for (size_t size : all) {
+        if (size == variableSize) {
+            return variableSize;
         }
-        *value = *it++;
-        return 1;
+        total += size;
     }
+    return total;
+}
 
-    template <typename TIter>
-    inline static Optional<size_t> serialize(const uint8_t* value, TIter&& it, TIter&& end) {
-        if (it == end) {
-            return nullopt;
-        }
-        *it++ = *value;
-        return 1;
-    }
+/** Fixed size of a serializer, with custom serializers not declaring it considered variable. */
+template <typename S, typename = void>
+struct fixed_size_of {
+    static constexpr size_t value = variableSize;
+};
 
+template <typename S>
+struct fixed_size_of<S, void_t<decltype(S::fixedSize)>> {
+    static constexpr size_t value = S::fixedSize;
 };
 
-template <>
-struct ValueSerializer<uint16_t> {
+/**
+ * Iterator which never reaches its end, used once the available space has already been checked.
+ * It wraps the actual iterator, which is advanced in place.
+ */
+template <typename TIter>
+class unchecked_iterator {
+public:
 
-    // We only support Big Endian integers
+    explicit unchecked_iterator(TIter& it) : _it(it) {}
 
-    template <typename TIter>
-    inline static Optional<size_t> deserialize(uint16_t* value, TIter&& it, TIter&& end) {
-        if (it == end) {
-            return nullopt;
-        }
-        *value = ((uint16_t) (*it++ & 0xFF) << 8);
+    constexpr bool operator==(const unchecked_iterator&) const { return false; }
+    constexpr bool operator!=(const unchecked_iterator&) const { return true; }
 
-        if (it == end) {
-            return nullopt;
-        }
-        *value |= (*it++ & 0xFF);
+    decltype(auto) operator*() { return *_it; }
 
-        return 2;
+    unchecked_iterator& operator++() {
+        ++_it;
+        return *this;
     }
 
-    template <typename TIter>
-    inline static Optional<size_t> serialize(const uint16_t* value, TIter&& it, TIter&& end) {
-        if (it == end) {
-            return nullopt;
-        }
-        *it++ = (uint8_t) ((*value >> 8) & 0xFF);
-        
-        if (it == end) {
-            return nullopt;
-        }
-        *it++ = (uint8_t) ((*value) & 0xFF);
+    auto operator++(int) { return _it++; }
 
-        return 2;
-    }
+private:
+    TIter& _it;
+};
 
+/** Whether the distance between two iterators can be computed directly, like for pointers. */
+template <typename TIter, typename = void>
+struct has_distance {
+    static constexpr bool value = false;
 };
 
-template <>
-struct ValueSerializer<uint32_t> {
+template <typename TIter>
+struct has_distance<TIter, void_t<decltype(declval<TIter>() - declval<TIter>())>> {
+    static constexpr bool value = true;
+};
+
+/** Serializer for integers, with the given encoding. */
+template <typename T, FieldEncoding Encoding>
+struct IntegerSerializer {
 
-    // We only support Big Endian integers
+    using U = make_unsigned_t<T>;
+
+    // Each byte of a varint holds 7 bits
+    static constexpr size_t maxVarintSize = (sizeof(T) * 8 + 6) / 7;
+
+    static constexpr size_t fixedSize = Encoding == FieldEncoding::Varint ? variableSize : sizeof(T);
 
     template <typename TIter>
-    inline static Optional<size_t> deserialize(uint32_t* value, TIter&& it, TIter&& end) {
-        *value = 0;
-        for (int i = 3; i >= 0; --i) {
-            if (it == end) {
-                return nullopt;
+    inline static Optional<size_t> deserialize(T* value, TIter&& it, TIter&& end) {
+        U x = 0;
+
+        if constexpr (Encoding == FieldEncoding::Varint) {
+            for (size_t i = 0; i < maxVarintSize; ++i) {
+                if (it == end) {
+                    return nullopt;
+                }
+                uint8_t b = *it++;
+
+                // The last byte may only hold the bits left in the type, without continuation
+                if (i == maxVarintSize - 1 && (b >> (sizeof(T) * 8 - i * 7)) != 0) {
+                    return nullopt;
+                }
+
+                x |= (U) (b & 0x7F) << (i * 7);
+                if ((b & 0x80) == 0) {
+                    // A final zero byte is an overlong encoding, which serialize never produces
+                    if (b == 0 && i > 0) {
+                        return nullopt;
+                    }
+                    *value = fromZigzag(x);
+                    return i + 1;
+                }
+            }
+            return nullopt;
+        } else {
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                if (it == end) {
+                    return nullopt;
+                }
+                x |= (U) (*it++ & 0xFF) << (shift(i) * 8);
             }
-            *value |= ((uint32_t) (*it++ & 0xFF) << (i * 8));
+            *value = (T) x;
+            return sizeof(T);
         }
-        return 4;
     }
 
     template <typename TIter>
-    inline static Optional<size_t> serialize(const uint32_t* value, TIter&& it, TIter&& end) {
-        for (int i = 3; i >= 0; --i) {
-            if (it == end) {
-                return nullopt;
+    inline static Optional<size_t> serialize(const T* value, TIter&& it, TIter&& end) {
+        if constexpr (Encoding == FieldEncoding::Varint) {
+            U x = toZigzag(*value);
+            for (size_t i = 1; ; ++i) {
+                if (it == end) {
+                    return nullopt;
+                }
+                if (x < 0x80) {
+                    *it++ = (uint8_t) x;
+                    return i;
+                }
+                *it++ = (uint8_t) (x | 0x80);
+                x >>= 7;
             }
-            *it++ = (uint8_t) ((*value >> (i * 8)) & 0xFF);
+        } else {
+            const U x = (U) *value;
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                if (it == end) {
+                    return nullopt;
+                }
+                *it++ = (uint8_t) ((x >> (shift(i) * 8)) & 0xFF);
+            }
+            return sizeof(T);
         }
-        return 4;
     }
 
+private:
+
+    /** Position of the i-th byte on the wire inside the value. */
+    static constexpr size_t shift(size_t i) {
+        return Encoding == FieldEncoding::LittleEndian ? i : sizeof(T) - 1 - i;
+    }
+
+    // Zigzag encoding maps small negative numbers to small varints: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+
+    static inline U toZigzag(T x) {
+        if constexpr (is_signed_v<T>) {
+            return (U) (((U) x << 1) ^ (U) (x >> (sizeof(T) * 8 - 1)));
+        } else {
+            return x;
+        }
+    }
+
+    static inline T fromZigzag(U x) {
+        if constexpr (is_signed_v<T>) {
+            return (T) ((U) (x >> 1) ^ (U) (0 - (U) (x & 1)));
+        } else {
+            return x;
+        }
+    }
+
+};
+
+template <typename T>
+struct ValueSerializer<T, enable_if_t<is_integer_v<T>>> : public IntegerSerializer<T, FieldEncoding::BigEndian> {
+    // Integers are Big Endian by default
 };
 
 template <>
 struct ValueSerializer<bool> {
 
-    // Yep, each bool takes a whole byte
+    // Each bool takes a whole byte, use PackedBools to pack groups of them
+    static constexpr size_t fixedSize = 1;
 
     template <typename TIter>
     inline static Optional<size_t> deserialize(bool* value, TIter&& it, TIter&& end) {
@@ -140,6 +234,8 @@ template <typename T, size_t N>
 struct ValueSerializer<T[N]> {
 
     // Serializer for arrays with compile-time known length delegate to the underlying type
+    static constexpr size_t fixedSize =
+        ValueSerializer<T>::fixedSize == variableSize ? variableSize : N * ValueSerializer<T>::fixedSize;
 
     template <typename TIter>
     inline static Optional<size_t> deserialize(T (*value)[N], TIter&& it, TIter&& end) {
@@ -175,6 +271,8 @@ struct ValueSerializer<T, enable_if_t<is_enum_v<T>>> {
     // Delegate enums to their underlying type
     using U = underlying_type_t<T>;
 
+    static constexpr size_t fixedSize = ValueSerializer<U>::fixedSize;
+
     template <typename TIter>
     inline static Optional<size_t> deserialize(T* value, TIter&& it, TIter&& end) {
         return ValueSerializer<U>::deserialize(reinterpret_cast<U*>(value), forward<TIter>(it), forward<TIter>(end));
@@ -209,6 +307,8 @@ struct ValueSerializer<T, enable_if_t<has_custom_serializer<T>::value>> {
     // Complex types can have serializers for themselves, use them
     using S = typename T::Serializer;
 
+    static constexpr size_t fixedSize = fixed_size_of<S>::value;
+
     template <typename TIter>
     inline static Optional<size_t> deserialize(T* value, TIter&& it, TIter&& end) {
         return S::deserialize(*value, forward<TIter>(it), forward<TIter>(end));
@@ -223,79 +323,294 @@ struct ValueSerializer<T, enable_if_t<has_custom_serializer<T>::value>> {
 
 
 
-/** Helper type to sequentially combine fields. */
-template <typename... Fields>
-struct combine_fields;
+/** Serializer for a value with a non default encoding, which applies to integers and to the elements of arrays. */
+template <typename T, FieldEncoding Encoding, typename Enable = void>
+struct EncodedValueSerializer : public ValueSerializer<T> {
+    static_assert(Encoding == FieldEncoding::BigEndian, "Encodings are supported only for integers, enums and arrays of them.");
+};
 
-template <typename F, typename... Rest>
-struct combine_fields<F, Rest...> {
+template <typename T, FieldEncoding Encoding>
+struct EncodedValueSerializer<T, Encoding, enable_if_t<is_integer_v<T>>> : public IntegerSerializer<T, Encoding> {
+};
 
-    using ContainerType = typename F::ContainerType;
-    static_assert(is_same_v<ContainerType, typename combine_fields<Rest...>::ContainerType>, "Can only combine fields of the same type");
+template <typename T, FieldEncoding Encoding>
+struct EncodedValueSerializer<T, Encoding, enable_if_t<is_enum_v<T>>> {
+
+    using U = underlying_type_t<T>;
+
+    static constexpr size_t fixedSize = EncodedValueSerializer<U, Encoding>::fixedSize;
 
     template <typename TIter>
-    inline static Optional<size_t> deserialize(typename F::ContainerType& obj, TIter&& it, TIter&& end) {
-        if (auto res1 = F::deserialize(obj, forward<TIter>(it), forward<TIter>(end))) {
-            if (auto res2 = combine_fields<Rest...>::deserialize(obj, forward<TIter>(it), forward<TIter>(end))) {
-                return (*res1) + (*res2);
+    inline static Optional<size_t> deserialize(T* value, TIter&& it, TIter&& end) {
+        return EncodedValueSerializer<U, Encoding>::deserialize(reinterpret_cast<U*>(value), forward<TIter>(it), forward<TIter>(end));
+    }
+
+    template <typename TIter>
+    inline static Optional<size_t> serialize(const T* value, TIter&& it, TIter&& end) {
+        return EncodedValueSerializer<U, Encoding>::serialize(reinterpret_cast<const U*>(value), forward<TIter>(it), forward<TIter>(end));
+    }
+
+};
+
+template <typename T, size_t N, FieldEncoding Encoding>
+struct EncodedValueSerializer<T[N], Encoding> {
+
+    static constexpr size_t fixedSize =
+        EncodedValueSerializer<T, Encoding>::fixedSize == variableSize ? variableSize : N * EncodedValueSerializer<T, Encoding>::fixedSize;
+
+    template <typename TIter>
+    inline static Optional<size_t> deserialize(T (*value)[N], TIter&& it, TIter&& end) {
+        size_t total = 0;
+        for (unsigned int i = 0; i < N; ++i) {
+            if (auto res = EncodedValueSerializer<T, Encoding>::deserialize(&((*value)[i]), forward<TIter>(it), forward<TIter>(end))) {
+                total += *res;
+            } else {
+                return nullopt;
             }
         }
-        return nullopt;
+        return total;
     }
 
     template <typename TIter>
-    inline static Optional<size_t> serialize(const typename F::ContainerType& obj, TIter&& it, TIter&& end) {
-        if (auto res1 = F::serialize(obj, forward<TIter>(it), forward<TIter>(end))) {
-            if (auto res2 = combine_fields<Rest...>::serialize(obj, forward<TIter>(it), forward<TIter>(end))) {
-                return (*res1) + (*res2);
+    inline static Optional<size_t> serialize(const T (*value)[N], TIter&& it, TIter&& end) {
+        size_t total = 0;
+        for (unsigned int i = 0; i < N; ++i) {
+            if (auto res = EncodedValueSerializer<T, Encoding>::serialize(&((*value)[i]), forward<TIter>(it), forward<TIter>(end))) {
+                total += *res;
+            } else {
+                return nullopt;
             }
         }
-        return nullopt;
+        return total;
     }
 
 };
 
-template <typename F>
-struct combine_fields<F> {
-    
+
+
+/** Helper type to sequentially combine fields. */
+template <typename F, typename... Rest>
+struct combine_fields {
+
     using ContainerType = typename F::ContainerType;
+    static_assert((is_same_v<ContainerType, typename Rest::ContainerType> && ...), "Can only combine fields of the same type");
+
+    static constexpr size_t fixedSize = sum_fixed_sizes(F::fixedSize, Rest::fixedSize...);
+
+    // The fields are processed in order, stopping at the first failure, and their sizes accumulated in place
 
     template <typename TIter>
     inline static Optional<size_t> deserialize(ContainerType& obj, TIter&& it, TIter&& end) {
-        return F::deserialize(obj, forward<TIter>(it), forward<TIter>(end));
+        size_t total = 0;
+        const bool ok = (step(total, F::deserialize(obj, forward<TIter>(it), forward<TIter>(end))) && ... &&
+            step(total, Rest::deserialize(obj, forward<TIter>(it), forward<TIter>(end))));
+        if (!ok) {
+            return nullopt;
+        }
+        return total;
     }
 
     template <typename TIter>
     inline static Optional<size_t> serialize(const ContainerType& obj, TIter&& it, TIter&& end) {
-        return F::serialize(obj, forward<TIter>(it), forward<TIter>(end));
+        size_t total = 0;
+        const bool ok = (step(total, F::serialize(obj, forward<TIter>(it), forward<TIter>(end))) && ... &&
+            step(total, Rest::serialize(obj, forward<TIter>(it), forward<TIter>(end))));
+        if (!ok) {
+            return nullopt;
+        }
+        return total;
     }
 
+private:
+
+    __attribute__((always_inline))
+    static inline bool step(size_t& total, Optional<size_t>&& res) {
+        if (res) {
+            total += *res;
+            return true;
+        }
+        return false;
+    }
+
+};
+
+
+/** Output iterator which only counts the bytes written to it, to compute the size of a serialized value. */
+class counting_iterator {
+public:
+
+    constexpr bool operator==(const counting_iterator&) const { return false; }
+    constexpr bool operator!=(const counting_iterator&) const { return true; }
+
+    inline counting_iterator& operator*() { return *this; }
+    inline counting_iterator& operator=(uint8_t) { return *this; }
+
+    inline counting_iterator& operator++() {
+        ++count;
+        return *this;
+    }
+
+    inline counting_iterator& operator++(int) {
+        ++count;
+        return *this;
+    }
+
+    size_t count = 0;
+};
+
+/**
+ * Iterator which stops after a given number of bytes, or at the end of the wrapped iterators.
+ * The wrapped iterators and the remaining count are shared by all the copies, so that they are advanced in place.
+ */
+template <typename TIter>
+class limited_iterator {
+public:
+
+    struct State {
+        TIter& it;
+        TIter& end;
+        size_t remaining;
+    };
+
+    explicit limited_iterator(State& state) : _state(&state) {}
+
+    inline bool operator==(const limited_iterator&) const { return _state->remaining == 0 || _state->it == _state->end; }
+    inline bool operator!=(const limited_iterator& other) const { return !(*this == other); }
+
+    inline decltype(auto) operator*() { return *_state->it; }
+
+    inline limited_iterator& operator++() {
+        ++_state->it;
+        --_state->remaining;
+        return *this;
+    }
+
+    inline auto operator++(int) {
+        --_state->remaining;
+        return _state->it++;
+    }
+
+private:
+    State* _state;
+};
+
+
+/** Whether a field descriptor is the one of the given member. */
+template <typename F, auto Member, typename = void>
+struct field_matches {
+    static constexpr bool value = false;
+};
+
+template <typename F, auto Member>
+struct field_matches<F, Member, enable_if_t<is_same_v<remove_cv_t<decltype(F::pointer)>, decltype(Member)>>> {
+    static constexpr bool value = F::pointer == Member;
+};
+
+template <typename F, size_t Offset>
+struct found_field {
+    using field = F;
+    static constexpr size_t offset = Offset;
+};
+
+/** Finds the descriptor of a member in a list of fixed size fields, along with its offset. */
+template <auto Member, size_t Offset, typename... Fields>
+struct find_field {
+    // Not found, there is no field
+};
+
+template <auto Member, size_t Offset, typename F, typename... Rest>
+struct find_field<Member, Offset, F, Rest...> : public conditional_t<
+    field_matches<remove_cv_t<F>, Member>::value,
+    found_field<F, Offset>,
+    find_field<Member, Offset + F::fixedSize, Rest...>
+> {
 };
 
 } // namespace __detail
 
 
 
-/** Descriptor for a single field of a serializable type. */
-template <typename TContainer, typename TValue, TValue TContainer::*member>
-struct Field<member> {
+/** Descriptor for a single field of a serializable type, with an optional encoding. */
+template <typename TContainer, typename TValue, TValue TContainer::*member, FieldEncoding Encoding>
+struct Field<member, Encoding> {
     using ContainerType = TContainer;
     using ValueType = TValue;
+    using ValueSerializer = __detail::EncodedValueSerializer<TValue, Encoding>;
+
+    static constexpr TValue TContainer::*pointer = member;
+
+    static constexpr size_t fixedSize = ValueSerializer::fixedSize;
+
+    template <typename TIter>
+    inline static Optional<size_t> deserialize(TContainer& obj, TIter&& it, TIter&& end) {
+        return ValueSerializer::deserialize(&(obj.*member), forward<TIter>(it), forward<TIter>(end));
+    }
+
+    template <typename TIter>
+    inline static Optional<size_t> serialize(const TContainer& obj, TIter&& it, TIter&& end) {
+        return ValueSerializer::serialize(&(obj.*member), forward<TIter>(it), forward<TIter>(end));
+    }
+};
+
+
+
+/** Descriptor for a group of bool fields of a serializable type, packed as bits (the first one is the LSB). */
+template <auto... members>
+struct PackedBools;
+
+template <typename TContainer, bool TContainer::*... members>
+struct PackedBools<members...> {
+    using ContainerType = TContainer;
+
+    static_assert(sizeof...(members) > 0, "At least one field is required.");
+
+    static constexpr size_t size = (sizeof...(members) + 7) / 8;
+    static constexpr size_t fixedSize = size;
 
     template <typename TIter>
     inline static Optional<size_t> deserialize(TContainer& obj, TIter&& it, TIter&& end) {
-        return __detail::ValueSerializer<TValue>::deserialize(&(obj.*member), forward<TIter>(it), forward<TIter>(end));
+        uint8_t bytes[size];
+        for (size_t i = 0; i < size; ++i) {
+            if (it == end) {
+                return nullopt;
+            }
+            bytes[i] = *it++;
+        }
+
+        // Like plain bools, reject anything that was not written by serialize
+        constexpr uint8_t unused = sizeof...(members) % 8 == 0 ? 0 : (0xFF << (sizeof...(members) % 8)) & 0xFF;
+        if ((bytes[size - 1] & unused) != 0) {
+            return nullopt;
+        }
+
+        size_t i = 0;
+        ((obj.*members = (bytes[i / 8] & (1 << (i % 8))) != 0, ++i), ...);
+        return size;
     }
 
     template <typename TIter>
     inline static Optional<size_t> serialize(const TContainer& obj, TIter&& it, TIter&& end) {
-        return __detail::ValueSerializer<TValue>::serialize(&(obj.*member), forward<TIter>(it), forward<TIter>(end));
+        uint8_t bytes[size] = {};
+        size_t i = 0;
+        ((bytes[i / 8] |= (obj.*members ? 1 : 0) << (i % 8), ++i), ...);
+
+        for (size_t j = 0; j < size; ++j) {
+            if (it == end) {
+                return nullopt;
+            }
+            *it++ = bytes[j];
+        }
+        return size;
     }
 };
 
 
 
-/** Combined serializer for a list of fields. */
+/**
+ * Combined serializer for a list of fields.
+ * When all the fields have a fixed size and the distance between the iterators can be computed (like with pointers),
+ * the available space is checked only once and then the fields are processed without any further bounds check.
+ */
 template <typename... Fields>
 class Serializer {
 
@@ -303,16 +618,44 @@ class Serializer {
 
 public:
 
+    /** Size of the serialized data, or variableSize if it depends on the values. */
+    static constexpr size_t fixedSize = CombinedFields::fixedSize;
+
+    using fields = list<Fields...>;
+
     template <typename TIter>
     inline static Optional<size_t> deserialize(typename CombinedFields::ContainerType& obj, TIter&& it, TIter&& end) {
-        return CombinedFields::deserialize(obj, forward<TIter>(it), forward<TIter>(end));
+        using I = remove_reference_t<TIter>;
+        if constexpr (hasFastPath<I>) {
+            if (end - it < (decltype(end - it)) fixedSize) {
+                return nullopt;
+            }
+            __detail::unchecked_iterator<I> uit(it), uend(it);
+            return CombinedFields::deserialize(obj, uit, uend);
+        } else {
+            return CombinedFields::deserialize(obj, forward<TIter>(it), forward<TIter>(end));
+        }
     }
 
     template <typename TIter>
     inline static Optional<size_t> serialize(const typename CombinedFields::ContainerType& obj, TIter&& it, TIter&& end) {
-        return CombinedFields::serialize(obj, forward<TIter>(it), forward<TIter>(end));
+        using I = remove_reference_t<TIter>;
+        if constexpr (hasFastPath<I>) {
+            if (end - it < (decltype(end - it)) fixedSize) {
+                return nullopt;
+            }
+            __detail::unchecked_iterator<I> uit(it), uend(it);
+            return CombinedFields::serialize(obj, uit, uend);
+        } else {
+            return CombinedFields::serialize(obj, forward<TIter>(it), forward<TIter>(end));
+        }
     }
 
+private:
+
+    template <typename I>
+    static constexpr bool hasFastPath = fixedSize != variableSize && __detail::has_distance<I>::value;
+
 };
 
 // Specialization to handle empty structures
@@ -320,6 +663,10 @@ template <>
 class Serializer<> {
 public:
 
+    static constexpr size_t fixedSize = 0;
+
+    using fields = list<>;
+
     template <typename TContainer, typename TIter>
     inline static Optional<size_t> deserialize(TContainer& obj, TIter&& it, TIter&& end) {
         return 0;
@@ -332,4 +679,176 @@ public:
 
 };
 
+
+
+
+/**
+ * Serializer for structures which evolve over time, for example when stored in the EEPROM or exchanged between nodes
+ * running different firmware versions. The fields are written as [version][payload length as varint][fields...],
+ * so that fields stay positional without any overhead per field.
+ *
+ * New fields must only be appended, bumping the version:
+ * - reading older data, the missing trailing fields keep their current values, so the object should be initialized
+ *   with the defaults before deserializing it;
+ * - reading newer data, the unknown trailing fields are skipped.
+ *
+ * Version 0xFF is reserved, so that erased EEPROM cells are never mistaken for valid data.
+ * The version of the data is given back by the overload of deserialize taking it as last argument,
+ * so that callers can tell which fields have been read, or whether the data comes from a newer version.
+ */
+template <uint8_t Version, typename... Fields>
+class VersionedSerializer {
+
+    static_assert(Version != 0xFF, "Version 0xFF is reserved.");
+
+    using ContainerType = typename __detail::combine_fields<Fields...>::ContainerType;
+    using Length = __detail::IntegerSerializer<uint16_t, FieldEncoding::Varint>;
+
+public:
+
+    static constexpr uint8_t version = Version;
+    static constexpr size_t fixedSize = variableSize;
+
+    template <typename TIter>
+    inline static Optional<size_t> deserialize(ContainerType& obj, TIter&& it, TIter&& end) {
+        uint8_t v;
+        return deserialize(obj, forward<TIter>(it), forward<TIter>(end), v);
+    }
+
+    /** Deserializes the data, storing the version it was written with in v. */
+    template <typename TIter>
+    inline static Optional<size_t> deserialize(ContainerType& obj, TIter&& it, TIter&& end, uint8_t& v) {
+        if (!__detail::ValueSerializer<uint8_t>::deserialize(&v, forward<TIter>(it), forward<TIter>(end)) || v == 0xFF) {
+            return nullopt;
+        }
+
+        uint16_t length;
+        auto header = Length::deserialize(&length, forward<TIter>(it), forward<TIter>(end));
+        if (!header) {
+            return nullopt;
+        }
+
+        using I = remove_reference_t<TIter>;
+        typename __detail::limited_iterator<I>::State state { it, end, length };
+        __detail::limited_iterator<I> lit(state), lend(state);
+
+        // Stop at the first missing field, but fail on fields cut in the middle
+        bool ok = true;
+        (void) ([&]() {
+            if (lit == lend) {
+                return false;
+            }
+            ok = Fields::deserialize(obj, lit, lend).has_value();
+            return ok;
+        }() && ...);
+        if (!ok) {
+            return nullopt;
+        }
+
+        // Skip the fields added by newer versions
+        while (state.remaining > 0) {
+            if (it == end) {
+                return nullopt;
+            }
+            (void) *it++;
+            --state.remaining;
+        }
+
+        return 1 + *header + length;
+    }
+
+    template <typename TIter>
+    inline static Optional<size_t> serialize(const ContainerType& obj, TIter&& it, TIter&& end) {
+
+        // The length of the payload is known in advance for fixed size layouts,
+        // otherwise it is computed first, without writing it anywhere
+        uint16_t length;
+        if constexpr (Payload::fixedSize != variableSize) {
+            length = Payload::fixedSize;
+        } else {
+            __detail::counting_iterator cit, cend;
+            if (!Payload::serialize(obj, cit, cend)) {
+                return nullopt;
+            }
+            length = cit.count;
+        }
+
+        if (!__detail::ValueSerializer<uint8_t>::serialize(&version, forward<TIter>(it), forward<TIter>(end))) {
+            return nullopt;
+        }
+        auto header = Length::serialize(&length, forward<TIter>(it), forward<TIter>(end));
+        if (!header || !Payload::serialize(obj, forward<TIter>(it), forward<TIter>(end))) {
+            return nullopt;
+        }
+
+        return 1 + *header + length;
+    }
+
+private:
+    using Payload = __detail::combine_fields<Fields...>;
+};
+
+
+
+
+/**
+ * Read-only view of a serialized structure with a fixed size layout, which decodes only the fields that are accessed,
+ * directly from where the data has been received, without copying it:
+ *
+ *     MessageView<DateTime> view(buffer);
+ *     if (*view.get<&DateTime::hours>() > 12) ...
+ *
+ * The iterator must support the addition of an offset, like pointers or CircularBuffer::PeekIterator,
+ * and at least size bytes must be available from the beginning of the view.
+ */
+template <typename T, typename TIter = const uint8_t*>
+class MessageView {
+
+    using Fields = typename T::Serializer::fields;
+
+    static_assert(T::Serializer::fixedSize != variableSize, "Views are available only for fixed size layouts.");
+
+public:
+
+    static constexpr size_t size = T::Serializer::fixedSize;
+
+    explicit MessageView(TIter begin) : _begin(begin) {}
+
+    /** Decodes the value of a single field, which cannot be an array. */
+    template <auto Member>
+    inline auto get() const {
+        using Found = typename find<Fields>::template field<Member>;
+        using F = typename Found::field;
+        using ValueType = typename F::ValueType;
+        static_assert(!is_array_v<ValueType>, "Array fields cannot be returned by value, use decode() instead.");
+
+        TIter it = _begin + Found::offset;
+        TIter end = it + F::fixedSize;
+        ValueType value;
+        if (!F::ValueSerializer::deserialize(&value, it, end)) {
+            return Optional<ValueType>();
+        }
+        return Optional<ValueType>(value);
+    }
+
+    /** Decodes the whole structure. */
+    inline Optional<size_t> decode(T& obj) const {
+        TIter it = _begin;
+        TIter end = _begin + size;
+        return T::Serializer::deserialize(obj, it, end);
+    }
+
+private:
+    TIter _begin;
+
+    template <typename L>
+    struct find;
+
+    template <typename... Fs>
+    struct find<list<Fs...>> {
+        template <auto Member>
+        using field = __detail::find_field<Member, 0, Fs...>;
+    };
+};
+
 } // namespace avr
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <inttypes.h>
+#include <util/atomic.h>
+
+#include "avr-utils/utility.hpp"
+#include "avr-utils/Pin.hpp"
+
+namespace avr {
+
+namespace detail {
+
+/** Duty cycle of a single pin, used while building the event tables. */
+struct soft_pwm_entry {
+    uint8_t mask;
+    uint8_t duty;
+};
+
+/** Event tables of all the pins of a single port driven by a software PWM engine. */
+template <typename Group>
+class soft_pwm_port {
+
+    using Traits = port_traits<Group::port>;
+
+    static constexpr uint8_t popcount(uint8_t x) {
+        return x == 0 ? 0 : (x & 1) + popcount(x >> 1);
+    }
+
+    // One event at tick 0 to set the pins, at most one event to clear each pin and a sentinel
+    static constexpr uint8_t maxEvents = popcount(Group::mask) + 2;
+
+    struct Table {
+        uint8_t ticks[maxEvents];
+        uint8_t values[maxEvents];
+    };
+
+    Table _tables[2] = {};
+    uint8_t _next = 0;
+
+public:
+
+    static constexpr uint8_t maxPins = popcount(Group::mask);
+
+    /** Builds the events for the given duty cycles, which get sorted in place. */
+    inline void build(uint8_t table, soft_pwm_entry* entries, uint8_t n) {
+        Table& t = _tables[table];
+
+        // Insertion sort, since there are at most 8 pins per port
+        for (uint8_t i = 1; i < n; ++i) {
+            soft_pwm_entry x = entries[i];
+            uint8_t j = i;
+            for (; j > 0 && entries[j - 1].duty > x.duty; --j) {
+                entries[j] = entries[j - 1];
+            }
+            entries[j] = x;
+        }
+
+        // At the beginning of the period, turn on all the pins with a duty cycle greater than zero
+        uint8_t value = 0;
+        for (uint8_t i = 0; i < n; ++i) {
+            if (entries[i].duty > 0) {
+                value |= entries[i].mask;
+            }
+        }
+        t.ticks[0] = 0;
+        t.values[0] = value;
+
+        // Then turn them off in order, merging the pins with the same duty cycle in a single event
+        uint8_t events = 1;
+        for (uint8_t i = 0; i < n; ++i) {
+            uint8_t duty = entries[i].duty;
+            if (duty == 0 || duty == 255) {
+                continue;
+            }
+            value &= ~entries[i].mask;
+            if (t.ticks[events - 1] == duty) {
+                t.values[events - 1] = value;
+            } else {
+                t.ticks[events] = duty;
+                t.values[events] = value;
+                ++events;
+            }
+        }
+
+        // The counter never reaches 255, so the sentinel never matches
+        t.ticks[events] = 255;
+    }
+
+    inline void restart() {
+        _next = 0;
+    }
+
+    __attribute__((always_inline))
+    inline void tick(uint8_t table, uint8_t counter) {
+        const Table& t = _tables[table];
+        uint8_t next = _next;
+        if (t.ticks[next] == counter) {
+            Traits::outputRegister() = (Traits::outputRegister() & ~Group::mask) | t.values[next];
+            _next = next + 1;
+        }
+    }
+
+};
+
+template <typename Groups>
+struct soft_pwm_ports;
+
+template <typename... Groups>
+struct soft_pwm_ports<list<Groups...>> : public soft_pwm_port<Groups>... {
+};
+
+} // namespace detail
+
+
+
+/**
+ * Software PWM engine for any output pin, driven by a periodic interrupt.
+ * Pins on the same port are merged (using the same grouping of PinGroup) and the duty cycles are compiled
+ * in a sorted table of events per port, so that each tick costs at most a single write for each port.
+ * A PWM period lasts 255 ticks, so that 0 and 255 are respectively always off and always on.
+ *
+ * The engine does not own any timer, so tick() must be called from an interrupt handler:
+ *
+ *     using Leds = SoftwarePWM<
+ *         Pin<Port::C, 0, PinMode::Output>,
+ *         Pin<Port::C, 1, PinMode::Output>,
+ *         Pin<Port::D, 4, PinMode::Output>
+ *     >;
+ *
+ *     ISR(TIMER0_COMPA_vect) {
+ *         Leds::tick();
+ *     }
+ *
+ *     Leds::init();
+ *     TimerConfig<0>
+ *         ::mode<TimerMode::ClearTimerOnCompareMatch>
+ *         ::prescaler<TimerPrescaler::By8>
+ *         ::compareMatchInterrupt<TimerChannel::A>
+ *         ::apply();
+ *     Timer<0>::setOutputCompareValue<TimerChannel::A>(39); // ~200Hz PWM at 16MHz
+ *
+ *     Leds::set<0>(10);
+ *     Leds::set<2>(200);
+ *     Leds::commit();
+ */
+template <typename... Pins>
+class SoftwarePWM {
+
+    static_assert(sizeof...(Pins) > 0, "At least one pin is required.");
+    static_assert(((Pins::mode == PinMode::Output) && ...), "Software PWM pins must be in output mode.");
+
+    using groups = typename detail::group_by_port_and_mode<Pins...>::type;
+
+public:
+
+    /** Initializes the pins. The timer driving tick() must be configured separately. */
+    static inline void init() {
+        PinGroup<Pins...>::init();
+    }
+
+    /** Stages a new duty cycle for the N-th pin, which is applied only by commit. */
+    template <size_t N>
+    static inline void set(uint8_t value) {
+        static_assert(N < sizeof...(Pins), "Pin index out of range.");
+        _duty[N] = value;
+    }
+
+    /** Rebuilds the tables with the staged duty cycles, which will be used starting from the next period. */
+    static inline void commit() {
+
+        // Discard any previous commit not picked up by the interrupt yet,
+        // so that the back tables are certainly not in use while rebuilding them
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            _pending = false;
+        }
+
+        const uint8_t back = _active ^ 1;
+        groups::for_each([back](auto g) {
+            build<decltype(g)>(back, make_index_sequence<sizeof...(Pins)>());
+        });
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            _pending = true;
+        }
+
+    }
+
+    /** Advances the engine by one tick. Must be called periodically from an interrupt handler. */
+    __attribute__((always_inline))
+    static inline void tick() {
+        uint8_t counter = _counter;
+
+        // Swap the tables only at the beginning of a period, to avoid glitches
+        if (counter == 0) {
+            if (_pending) {
+                _active ^= 1;
+                _pending = false;
+            }
+            groups::for_each([](auto g) {
+                port<decltype(g)>().restart();
+            });
+        }
+
+        const uint8_t table = _active;
+        groups::for_each([table, counter](auto g) {
+            port<decltype(g)>().tick(table, counter);
+        });
+
+        _counter = counter == 254 ? 0 : counter + 1;
+    }
+
+private:
+
+    static inline uint8_t _duty[sizeof...(Pins)] = {};
+    static inline detail::soft_pwm_ports<groups> _ports;
+    static inline uint8_t _counter = 0;
+    static inline volatile uint8_t _active = 0;
+    static inline volatile bool _pending = false;
+
+    template <typename Group>
+    static inline detail::soft_pwm_port<Group>& port() {
+        return static_cast<detail::soft_pwm_port<Group>&>(_ports);
+    }
+
+    template <typename Group, size_t... Is>
+    static inline void build(uint8_t table, index_sequence<Is...>) {
+        detail::soft_pwm_entry entries[detail::soft_pwm_port<Group>::maxPins];
+        uint8_t n = 0;
+
+        // Collect the duty cycles of the pins on this port
+        ([&entries, &n]() {
+            using Pin = type_at_t<Is, Pins...>;
+            if constexpr (Pin::port == Group::port) {
+                entries[n++] = { Pin::mask, _duty[Is] };
+            }
+        }(), ...);
+
+        port<Group>().build(table, entries, n);
+    }
+
+};
+
+/** A software PWM engine can also be built directly from a PinGroup. */
+template <typename... Pins>
+class SoftwarePWM<PinGroup<Pins...>> : public SoftwarePWM<Pins...> {
+};
+
+} // namespace avr
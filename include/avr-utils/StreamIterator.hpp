@@ -0,0 +1,85 @@
+#pragma once
+
+#include <inttypes.h>
+
+namespace avr {
+
+/**
+ * Describes when a byte stream can be written or read without blocking forever.
+ * By default streams are bounded buffers, like CircularBuffer.
+ */
+template <typename Stream>
+struct stream_traits {
+    static inline bool canWrite(Stream& stream) { return !stream.isFull(); }
+    static inline bool canRead(Stream& stream) { return !stream.isEmpty(); }
+};
+
+
+
+/**
+ * Output iterator writing directly to a byte stream, so that values can be serialized without an intermediate buffer.
+ * A default constructed writer is the end, which is reached when the stream cannot accept more bytes:
+ *
+ *     StreamWriter<CircularBuffer<32>> it(buffer), end;
+ *     DateTime::Serializer::serialize(now, it, end);
+ */
+template <typename Stream>
+class StreamWriter {
+public:
+
+    StreamWriter() : _stream(nullptr) {}
+    explicit StreamWriter(Stream& stream) : _stream(&stream) {}
+
+    inline bool operator==(const StreamWriter& other) const { return atEnd() && other.atEnd(); }
+    inline bool operator!=(const StreamWriter& other) const { return !(*this == other); }
+
+    // Dereferencing gives back the writer itself, which writes the assigned bytes
+    inline StreamWriter& operator*() { return *this; }
+
+    inline StreamWriter& operator=(uint8_t x) {
+        _stream->write(x);
+        return *this;
+    }
+
+    inline StreamWriter& operator++() { return *this; }
+    inline StreamWriter& operator++(int) { return *this; }
+
+private:
+    Stream* _stream;
+
+    inline bool atEnd() const {
+        return _stream == nullptr || !stream_traits<Stream>::canWrite(*_stream);
+    }
+};
+
+
+
+/**
+ * Input iterator consuming a byte stream, so that values can be deserialized while they are received.
+ * A default constructed reader is the end, which is reached when the stream has no more bytes.
+ */
+template <typename Stream>
+class StreamReader {
+public:
+
+    StreamReader() : _stream(nullptr) {}
+    explicit StreamReader(Stream& stream) : _stream(&stream) {}
+
+    inline bool operator==(const StreamReader& other) const { return atEnd() && other.atEnd(); }
+    inline bool operator!=(const StreamReader& other) const { return !(*this == other); }
+
+    // Each dereference consumes a byte, so it must happen exactly once per increment
+    inline uint8_t operator*() { return _stream->read(); }
+
+    inline StreamReader& operator++() { return *this; }
+    inline StreamReader& operator++(int) { return *this; }
+
+private:
+    Stream* _stream;
+
+    inline bool atEnd() const {
+        return _stream == nullptr || !stream_traits<Stream>::canRead(*_stream);
+    }
+};
+
+} // namespace avr
@@ -14,8 +14,19 @@ template <int I>
 class Timer {
 
     using Traits = timer_traits<I>;
+
+public:
+
+    static constexpr int index = I;
+
+    /** Type of the counter, which is either 8 or 16 bits wide. */
     using ValueType = typename Traits::ValueType;
 
+    /** Mode used when one of the pins attached to this timer is configured as PinMode::PWM. */
+    static constexpr TimerMode pwmMode = Traits::pwmMode;
+
+private:
+
     // Some timers have values with more than 8 bits,
     // so we need to disable interrupts when reading them to avoid a data race
     static constexpr bool needsLocking = sizeof(ValueType) > 1;
@@ -34,6 +45,15 @@ public:
         Traits::template setPrescaler<Prescaler>();
     }
 
+    /** Sets both mode and prescaler of the timer, touching each control register only once. */
+    template <TimerMode Mode, TimerPrescaler Prescaler>
+    static inline void configure() {
+        uint8_t regA = Traits::controlRegisterA() & ~Traits::modeMaskA;
+        uint8_t regB = Traits::controlRegisterB() & ~(Traits::modeMaskB | Traits::prescalerMask);
+        Traits::controlRegisterA() = regA | Traits::template modeBitsA<Mode>();
+        Traits::controlRegisterB() = regB | Traits::template modeBitsB<Mode>() | Traits::template prescalerBits<Prescaler>();
+    }
+
     /** Returns the current value of the counter. */
     static inline ValueType counterValue() {
         if constexpr (needsLocking) {
@@ -47,6 +67,17 @@ public:
         }
     }
 
+    /** Sets the current value of the counter. */
+    static inline void setCounterValue(ValueType x) {
+        if constexpr (needsLocking) {
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                Traits::counterValueRegister() = x;
+            }
+        } else {
+            Traits::counterValueRegister() = x;
+        }
+    }
+
     /** Starts the output for the given channel. */
     template <TimerChannel Channel>
     static inline void startOutput() {
@@ -81,6 +112,14 @@ public:
         }
     }
 
+    /** Sets the value of the input capture register, used as TOP in the ICR modes. */
+    static inline void setInputCaptureValue(ValueType x) {
+        static_assert(sizeof(ValueType) > 1, "Only 16 bit timers have an input capture register.");
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            Traits::inputCaptureRegister() = x;
+        }
+    }
+
     /** Enables the overflow interrupt for this timer. */
     static inline void enableOverflowInterrupt() {
         Traits::interruptMaskRegister() |= (1 << Traits::TOIE);
@@ -107,4 +146,122 @@ public:
 
 };
 
+
+
+/**
+ * Compile-time description of the whole configuration of a timer.
+ * While the setters of Timer do a read-modify-write for each setting, apply() computes the final value
+ * of the registers at compile time and writes each of them exactly once.
+ * Everything which is not explicitly requested is reset, i.e. outputs disconnected and interrupts disabled.
+ *
+ *     using Config = TimerConfig<1>
+ *         ::mode<TimerMode::FastPWMICR>
+ *         ::prescaler<TimerPrescaler::By8>
+ *         ::output<TimerChannel::A>
+ *         ::overflowInterrupt;
+ *
+ *     Config::apply();
+ */
+template <
+    int I,
+    TimerMode Mode = TimerMode::Normal,
+    TimerPrescaler Prescaler = TimerPrescaler::Off,
+    uint8_t Outputs = 0,
+    uint8_t Interrupts = 0
+>
+class TimerConfig {
+
+    using Traits = timer_traits<I>;
+
+    template <TimerChannel Channel, bool Inverted>
+    static constexpr uint8_t outputBits =
+        Channel == TimerChannel::A
+            ? (1 << Traits::COMA1) | (Inverted ? (1 << Traits::COMA0) : 0)
+            : (1 << Traits::COMB1) | (Inverted ? (1 << Traits::COMB0) : 0);
+
+    template <TimerChannel Channel>
+    static constexpr uint8_t compareMatchBit = 1 << (Channel == TimerChannel::A ? Traits::OCIEA : Traits::OCIEB);
+
+public:
+
+    using timer = Timer<I>;
+
+    // Builders
+
+    template <TimerMode M>
+    using mode = TimerConfig<I, M, Prescaler, Outputs, Interrupts>;
+
+    template <TimerPrescaler P>
+    using prescaler = TimerConfig<I, Mode, P, Outputs, Interrupts>;
+
+    /** Non-inverting output on the given channel, the same one enabled by Timer::startOutput. */
+    template <TimerChannel Channel>
+    using output = TimerConfig<I, Mode, Prescaler, Outputs | outputBits<Channel, false>, Interrupts>;
+
+    template <TimerChannel Channel>
+    using invertedOutput = TimerConfig<I, Mode, Prescaler, Outputs | outputBits<Channel, true>, Interrupts>;
+
+    using overflowInterrupt = TimerConfig<I, Mode, Prescaler, Outputs, Interrupts | (1 << Traits::TOIE)>;
+
+    template <TimerChannel Channel>
+    using compareMatchInterrupt = TimerConfig<I, Mode, Prescaler, Outputs, Interrupts | compareMatchBit<Channel>>;
+
+    // Final values of the registers
+
+    static constexpr uint8_t controlRegisterA = Traits::template modeBitsA<Mode>() | Outputs;
+    static constexpr uint8_t controlRegisterB = Traits::template modeBitsB<Mode>() | Traits::template prescalerBits<Prescaler>();
+    static constexpr uint8_t interruptMask = Interrupts;
+
+    /** Writes the configuration to the timer. */
+    static inline void apply() {
+        Traits::controlRegisterA() = controlRegisterA;
+        Traits::interruptMaskRegister() = interruptMask;
+
+        // The clock select bits live here, so the timer starts (or stops) only once everything else is in place
+        Traits::controlRegisterB() = controlRegisterB;
+    }
+
+};
+
+
+
+/**
+ * Runs f with the prescalers of the given timers halted, so that none of them can advance meanwhile.
+ * Only the prescaler reset bits of the given timers are asserted: PSRASY only when Timer2 is among them.
+ * Note that timers 0 and 1 share the same prescaler, so halting one of them halts the other too.
+ * Halting resets the prescalers, so the timer tick in progress restarts: the PWM period at that moment
+ * is stretched by up to one tick, and when Timer2 is halted Clock::millis() falls behind by as much.
+ */
+template <int First, int... Rest, typename F>
+static inline void withTimersHalted(F&& f) {
+
+    // The general control register is the same for all the timers
+    using Traits = timer_traits<First>;
+    constexpr uint8_t resetBits = (1 << Traits::PSR) | ((1 << timer_traits<Rest>::PSR) | ... | 0);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+
+        // While the synchronization mode is enabled, the prescaler reset bits stay asserted
+        Traits::generalControlRegister() = (1 << Traits::SYNC) | resetBits;
+
+        f();
+
+        // Clearing the synchronization mode releases all the prescalers in the same clock cycle
+        Traits::generalControlRegister() = 0;
+
+    }
+}
+
+/**
+ * Applies all the given configurations while the involved timers are halted,
+ * then resets their counters and restarts them at the same time, so that their cycles are aligned.
+ */
+template <typename... Configs>
+static inline void applySynchronized() {
+    withTimersHalted<Configs::timer::index...>([]() {
+        (Configs::apply(), ...);
+        (Configs::timer::setCounterValue(0), ...);
+    });
+}
+
 } // namespace avr
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
+#include <avr/pgmspace.h>
 
 #include "avr-utils/utility.hpp"
 #include "avr-utils/Serializable.hpp"
@@ -46,91 +48,132 @@ private:
 
 
 
-template <typename TVariant, typename... Rest>
-struct variant_helper;
+/**
+ * Operations on the value of a variant, dispatched on its tag in constant time.
+ * Each operation is a template instantiated for all the types, whose pointers are stored in a table in program memory,
+ * so that calling it costs a single table lookup, irrespectively of the number of types.
+ */
+template <typename TVariant, typename... Ts>
+struct variant_helper {
 
-template <typename TVariant, typename T, typename... Rest>
-struct variant_helper<TVariant, T, Rest...> {
+    static constexpr bool triviallyDestructible = (is_trivially_destructible_v<Ts> && ...);
+    static constexpr bool triviallyCopyable = (is_trivially_copyable_v<Ts> && ...);
 
     inline static void destroy(uint8_t tag, void* storage) {
-        if (tag == TVariant::Tags::template get<T>()) {
-            reinterpret_cast<T*>(storage)->~T();
-        } else {
-            variant_helper<TVariant, Rest...>::destroy(tag, storage);
+        if constexpr (!triviallyDestructible) {
+            if (tag != TVariant::Tags::invalid) {
+                dispatch<destroy_op>(tag, storage);
+            }
         }
     }
 
-    inline static void copy(uint8_t otherTag, void* otherStorage, void* storage) {
-        if (otherTag == TVariant::Tags::template get<T>()) {
-            new (storage) T(*reinterpret_cast<T*>(otherStorage));
-        } else {
-            variant_helper<TVariant, Rest...>::copy(otherTag, otherStorage, storage);
+    inline static void copy(uint8_t otherTag, const void* otherStorage, void* storage) {
+        if (otherTag != TVariant::Tags::invalid) {
+            dispatch<copy_op>(otherTag, otherStorage, storage);
+        }
+    }
+
+    inline static void move(uint8_t otherTag, void* otherStorage, void* storage) {
+        if (otherTag != TVariant::Tags::invalid) {
+            dispatch<move_op>(otherTag, otherStorage, storage);
         }
     }
 
+    // The visitor is always valid, since invalid variants cannot be visited
+
     template <typename TVisitor>
     inline static void visit(uint8_t tag, void* storage, TVisitor&& visitor) {
-        if (tag == TVariant::Tags::template get<T>()) {
-            visitor(*reinterpret_cast<T*>(storage));
-        } else {
-            variant_helper<TVariant, Rest...>::visit(tag, storage, forward<TVisitor>(visitor));
-        }
+        dispatch<visit_op<remove_reference_t<TVisitor>>>(tag, storage, &visitor);
     }
 
     template <typename TVisitor>
     inline static void visit(uint8_t tag, const void* storage, TVisitor&& visitor) {
-        if (tag == TVariant::Tags::template get<T>()) {
-            visitor(*reinterpret_cast<const T*>(storage));
-        } else {
-            variant_helper<TVariant, Rest...>::visit(tag, storage, forward<TVisitor>(visitor));
-        }
+        dispatch<const_visit_op<remove_reference_t<TVisitor>>>(tag, storage, &visitor);
     }
 
     template <typename TIter>
     inline static Optional<size_t> deserialize(uint8_t tag, TVariant& v, TIter&& it, TIter&& end) {
-        if (tag == TVariant::Tags::template get<T>()) {
-            v.template emplace<T>();
-            auto& x = v.template get<T>();
-            return ValueSerializer<T>::deserialize(&x, forward<TIter>(it), forward<TIter>(end));
-        } else {
-            return variant_helper<TVariant, Rest...>::deserialize(tag, v, forward<TIter>(it), forward<TIter>(end));
+        if (tag == TVariant::Tags::invalid || tag > sizeof...(Ts)) {
+            return nullopt;
         }
+        using I = remove_reference_t<TIter>;
+        return dispatch<deserialize_op<I>>(tag, &v, &it, &end);
     }
-    
+
     template <typename TIter>
     inline static Optional<size_t> serialize(const TVariant& v, TIter&& it, TIter&& end) {
-        if (v.template is<T>()) {
-            auto& x = v.template get<T>();
-            return ValueSerializer<T>::serialize(&x, forward<TIter>(it), forward<TIter>(end));
-        } else {
-            return variant_helper<TVariant, Rest...>::serialize(v, forward<TIter>(it), forward<TIter>(end));
+        if (v.isInvalid()) {
+            return nullopt;
         }
+        using I = remove_reference_t<TIter>;
+        return dispatch<serialize_op<I>>(v.tag(), &v, &it, &end);
     }
 
-};
+private:
 
-template <typename TVariant>
-struct variant_helper<TVariant> {
+    /** Calls Op::call<T> for the type T with the given tag, which must be valid. */
+    template <typename Op, typename... Args>
+    inline static auto dispatch(uint8_t tag, Args... args) {
+        using Fn = decltype(&Op::template call<type_at_t<0, Ts...>>);
+        static const Fn table[] PROGMEM = { &Op::template call<Ts>... };
+        return ((Fn) pgm_read_ptr(&table[tag - 1]))(args...);
+    }
 
-    inline static void destroy(uint8_t tag, void* storage) {}
+    struct destroy_op {
+        template <typename T>
+        static void call(void* storage) {
+            reinterpret_cast<T*>(storage)->~T();
+        }
+    };
 
-    inline static void copy(uint8_t otherTag, void* otherStorage, void* storage) {}
+    struct copy_op {
+        template <typename T>
+        static void call(const void* otherStorage, void* storage) {
+            new (storage) T(*reinterpret_cast<const T*>(otherStorage));
+        }
+    };
+
+    struct move_op {
+        template <typename T>
+        static void call(void* otherStorage, void* storage) {
+            new (storage) T(avr::move(*reinterpret_cast<T*>(otherStorage)));
+        }
+    };
 
     template <typename TVisitor>
-    inline static void visit(uint8_t tag, void* storage, TVisitor&& visitor) {}
+    struct visit_op {
+        template <typename T>
+        static void call(void* storage, TVisitor* visitor) {
+            (*visitor)(*reinterpret_cast<T*>(storage));
+        }
+    };
 
     template <typename TVisitor>
-    inline static void visit(uint8_t tag, const void* storage, TVisitor&& visitor) {}
+    struct const_visit_op {
+        template <typename T>
+        static void call(const void* storage, TVisitor* visitor) {
+            (*visitor)(*reinterpret_cast<const T*>(storage));
+        }
+    };
 
     template <typename TIter>
-    inline static Optional<size_t> deserialize(uint8_t, TVariant&, TIter&&, TIter&&) {
-        return nullopt;
-    }
-    
+    struct deserialize_op {
+        template <typename T>
+        static Optional<size_t> call(TVariant* v, TIter* it, TIter* end) {
+            v->template emplace<T>();
+            auto& x = v->template get<T>();
+            return ValueSerializer<T>::deserialize(&x, *it, *end);
+        }
+    };
+
     template <typename TIter>
-    inline static Optional<size_t> serialize(const TVariant&, TIter&&, TIter&&) {
-        return nullopt;
-    }
+    struct serialize_op {
+        template <typename T>
+        static Optional<size_t> call(const TVariant* v, TIter* it, TIter* end) {
+            auto& x = v->template get<T>();
+            return ValueSerializer<T>::serialize(&x, *it, *end);
+        }
+    };
 
 };
 
@@ -192,7 +235,9 @@ struct variant_serializer {
 
 /**
  * A barely usable type-safe tagged union.
- * This is a very simple variant. No exception safety, no repeated types, no move semantics.
+ * This is a very simple variant. No exception safety, no repeated types.
+ * Operations on the value are dispatched through tables in program memory, in constant time,
+ * and are skipped entirely when all the types are trivial.
  */
 template <typename... Ts>
 class Variant {
@@ -211,6 +256,25 @@ class Variant {
     uint8_t _tag; // All tags start from 1
     TStorage _storage;
 
+    // Trivial values are copied and moved as raw bytes, whatever their type
+    inline void copyFrom(const Variant<Ts...>& other) {
+        if constexpr (Helper::triviallyCopyable) {
+            memcpy(&_storage, &other._storage, sizeof(TStorage));
+        } else {
+            Helper::copy(other._tag, &other._storage, &_storage);
+        }
+        _tag = other._tag;
+    }
+
+    inline void moveFrom(Variant<Ts...>& other) {
+        if constexpr (Helper::triviallyCopyable) {
+            memcpy(&_storage, &other._storage, sizeof(TStorage));
+        } else {
+            Helper::move(other._tag, &other._storage, &_storage);
+        }
+        _tag = other._tag;
+    }
+
 public:
 
     // As tags we use the index inside the template pack Ts.
@@ -224,40 +288,47 @@ public:
     {
     }
 
-    template <typename T>
+    template <typename T, typename = enable_if_t<!is_same_v<remove_cv_t<remove_reference_t<T>>, Variant<Ts...>>>>
     Variant(T&& val)
         : _tag(Tags::invalid)
     {
         set(forward<T>(val));
     }
 
-    Variant(Variant<Ts...>&& other) = delete; // Non-movable
+    Variant(const Variant<Ts...>& other) {
+        copyFrom(other);
+    }
 
-    Variant(const Variant<Ts...>& other)
-        : _tag(other.tag)
-    {
-        Helper::copy(other._tag, &other._storage, &_storage);
+    /** Moves the value of the other variant, which is left holding a moved-from value. */
+    Variant(Variant<Ts...>&& other) {
+        moveFrom(other);
     }
 
     ~Variant() {
         Helper::destroy(_tag, &_storage);
     }
 
-    // Only copy assigment
     Variant<Ts...>& operator=(const Variant<Ts...>& other) {
-        if (this != other) {
+        if (this != &other) {
 
             // Destroy our value
             Helper::destroy(_tag, &_storage);
 
             // Copy the value of the other variant into our storage
-            Helper::copy(other._tag, &other._storage, &_storage);
-            _tag = other._tag;
+            copyFrom(other);
 
         }
         return *this;
     }
 
+    Variant<Ts...>& operator=(Variant<Ts...>&& other) {
+        if (this != &other) {
+            Helper::destroy(_tag, &_storage);
+            moveFrom(other);
+        }
+        return *this;
+    }
+
     template <typename T>
     inline T& get() {
         // Make sure that we are accessing the right value
@@ -310,7 +381,7 @@ public:
         Helper::destroy(_tag, &_storage);
 
         // Copy or move the value in the storage
-        using T_noreference = typename remove_reference<T>::type;
+        using T_noreference = remove_cv_t<remove_reference_t<T>>;
         new (&_storage) T_noreference(forward<T>(arg));
         _tag = Tags::template get<T_noreference>();
         
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <inttypes.h>
+#include <util/crc16.h>
+
+#include "avr-utils/utility.hpp"
+#include "avr-utils/Optional.hpp"
+#include "avr-utils/Serializable.hpp"
+
+namespace avr {
+
+// Checksum algorithms, computed one byte at a time with the optimized implementations of avr-libc
+
+/** CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF. */
+struct CRC16CCITT {
+    using ValueType = uint16_t;
+    static constexpr ValueType initial = 0xFFFF;
+
+    static inline ValueType update(ValueType crc, uint8_t x) {
+        return _crc_xmodem_update(crc, x);
+    }
+};
+
+/** CRC-8 with polynomial 0x07 and initial value 0. */
+struct CRC8 {
+    using ValueType = uint8_t;
+    static constexpr ValueType initial = 0;
+
+    static inline ValueType update(ValueType crc, uint8_t x) {
+        return _crc8_ccitt_update(crc, x);
+    }
+};
+
+
+
+namespace __detail {
+
+/**
+ * Iterator which updates a checksum with all the bytes written or read through it.
+ * Like limited_iterator, the wrapped iterators and the checksum are shared by all the copies.
+ */
+template <typename TIter, typename CRC>
+class crc_iterator {
+public:
+
+    struct State {
+        TIter& it;
+        TIter& end;
+        typename CRC::ValueType crc;
+    };
+
+    /** Single byte at the given position, which updates the checksum when it is either read or written. */
+    template <typename It>
+    class Reference {
+    public:
+        Reference(It it, State* state) : _it(it), _state(state) {}
+
+        inline operator uint8_t() {
+            uint8_t x = *_it;
+            _state->crc = CRC::update(_state->crc, x);
+            return x;
+        }
+
+        inline Reference& operator=(uint8_t x) {
+            _state->crc = CRC::update(_state->crc, x);
+            *_it = x;
+            return *this;
+        }
+
+    private:
+        It _it;
+        State* _state;
+    };
+
+    /** Position returned by the postfix increment, which still refers to the previous byte. */
+    template <typename It>
+    class Position {
+    public:
+        Position(It it, State* state) : _it(it), _state(state) {}
+
+        inline Reference<It> operator*() { return Reference<It>(_it, _state); }
+
+    private:
+        It _it;
+        State* _state;
+    };
+
+    explicit crc_iterator(State& state) : _state(&state) {}
+
+    inline bool operator==(const crc_iterator&) const { return _state->it == _state->end; }
+    inline bool operator!=(const crc_iterator& other) const { return !(*this == other); }
+
+    inline Reference<TIter> operator*() { return Reference<TIter>(_state->it, _state); }
+
+    inline crc_iterator& operator++() {
+        ++_state->it;
+        return *this;
+    }
+
+    inline auto operator++(int) {
+        using It = remove_cv_t<remove_reference_t<decltype(_state->it++)>>;
+        return Position<It>(_state->it++, _state);
+    }
+
+private:
+    State* _state;
+};
+
+} // namespace __detail
+
+
+
+/**
+ * Wraps a serializer appending a checksum of the serialized data, big endian, which is verified when deserializing.
+ * The checksum is computed while the data is written or read, so it works with any iterator, including streams:
+ *
+ *     using Frame = ChecksummedSerializer<CRC16CCITT, DateTime::Serializer>;
+ *     Frame::serialize(now, it, end);
+ */
+template <typename CRC, typename Inner>
+class ChecksummedSerializer {
+
+    using Checksum = __detail::ValueSerializer<typename CRC::ValueType>;
+
+public:
+
+    static constexpr size_t fixedSize =
+        Inner::fixedSize == variableSize ? variableSize : Inner::fixedSize + sizeof(typename CRC::ValueType);
+
+    template <typename T, typename TIter>
+    inline static Optional<size_t> deserialize(T& obj, TIter&& it, TIter&& end) {
+        using I = remove_reference_t<TIter>;
+        typename __detail::crc_iterator<I, CRC>::State state { it, end, CRC::initial };
+        __detail::crc_iterator<I, CRC> cit(state), cend(state);
+
+        auto res = Inner::deserialize(obj, cit, cend);
+        if (!res) {
+            return nullopt;
+        }
+
+        typename CRC::ValueType expected;
+        if (!Checksum::deserialize(&expected, forward<TIter>(it), forward<TIter>(end)) || expected != state.crc) {
+            return nullopt;
+        }
+
+        return *res + sizeof(expected);
+    }
+
+    template <typename T, typename TIter>
+    inline static Optional<size_t> serialize(const T& obj, TIter&& it, TIter&& end) {
+        using I = remove_reference_t<TIter>;
+        typename __detail::crc_iterator<I, CRC>::State state { it, end, CRC::initial };
+        __detail::crc_iterator<I, CRC> cit(state), cend(state);
+
+        auto res = Inner::serialize(obj, cit, cend);
+        if (!res || !Checksum::serialize(&state.crc, forward<TIter>(it), forward<TIter>(end))) {
+            return nullopt;
+        }
+
+        return *res + sizeof(state.crc);
+    }
+
+};
+
+} // namespace avr
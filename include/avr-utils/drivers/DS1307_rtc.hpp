@@ -22,6 +22,9 @@ public:
     /** Returns a value indicating wether the RTC is enabled or not. */
     bool isRunning() const;
 
+    /** Enables or disables the 1Hz square wave output, whose falling edge marks the beginning of each second. */
+    void enableSquareWave(bool enable = true) const;
+
 private:
     const uint8_t _address;
 };
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stddef.h>
+#include <inttypes.h>
+#include <util/atomic.h>
+
+#include "avr-utils/Timer.hpp"
+#include "avr-utils/drivers/ShiftRegister.hpp"
+
+namespace avr {
+
+/**
+ * Background refresh engine for displays multiplexed through a chain of shift registers,
+ * like seven-segment displays and LED matrices.
+ * Each row of a frame is the whole image of the chain (including the bits selecting the row),
+ * and a row is shifted out at each compare match of the given timer, so that the refresh rate
+ * does not depend on the load of the main loop.
+ *
+ * Frames are double-buffered: the application draws in the back frame and commits it,
+ * and the engine swaps the frames at the beginning of the next refresh cycle.
+ * The display takes over the given timer, which runs in CTC mode with TOP on channel A,
+ * so it cannot be shared with hardware PWM on its pins, and refresh() must be called from its interrupt handler.
+ * Timer2 is already used by Clock, so Timer0 or Timer1 is usually the one to give:
+ *
+ *     using Display = MultiplexedDisplay<
+ *         ShiftRegister<Pin<Port::B, 5, PinMode::Output>, Pin<Port::B, 2, PinMode::Output>, Pin<Port::B, 3, PinMode::Output>,
+ *             ShiftDirection::MSBFirst, 2>,
+ *         8, // Rows
+ *         1  // Timer
+ *     >;
+ *
+ *     ISR(TIMER1_COMPA_vect) {
+ *         Display::refresh();
+ *     }
+ *
+ *     Display::init<TimerPrescaler::By64>(499); // A row every 2ms at 16MHz
+ *
+ *     Display::setByte(0, 1, 0b10100101);
+ *     Display::commit();
+ */
+template <typename Register, size_t Rows, int TimerIndex>
+class MultiplexedDisplay {
+
+    static_assert(Rows > 0 && Rows <= 256, "Between 1 and 256 rows are supported.");
+
+    using Config = typename TimerConfig<TimerIndex>
+        ::template mode<TimerMode::ClearTimerOnCompareMatch>
+        ::template compareMatchInterrupt<TimerChannel::A>;
+
+    static constexpr size_t Bytes = Register::bytes;
+
+public:
+
+    using timer = Timer<TimerIndex>;
+
+    /** Initializes the registers and starts the timer, with a row every period + 1 timer ticks. */
+    template <TimerPrescaler Prescaler>
+    static inline void init(typename timer::ValueType period) {
+        Register::init();
+        timer::template setOutputCompareValue<TimerChannel::A>(period);
+        Config::template prescaler<Prescaler>::apply();
+    }
+
+    /** Clears the back frame. */
+    static inline void clear() {
+        uint8_t* frame = &_frames[_front ^ 1][0][0];
+        for (size_t i = 0; i < Rows * Bytes; ++i) {
+            frame[i] = 0;
+        }
+    }
+
+    /** Sets the i-th register of a row of the back frame. */
+    static inline void setByte(size_t row, size_t i, uint8_t value) {
+        _frames[_front ^ 1][row][Bytes - 1 - i] = value;
+    }
+
+    static inline void setBit(size_t row, size_t bit) {
+        _frames[_front ^ 1][row][Bytes - 1 - bit / 8] |= (1 << (bit % 8));
+    }
+
+    static inline void clearBit(size_t row, size_t bit) {
+        _frames[_front ^ 1][row][Bytes - 1 - bit / 8] &= ~(1 << (bit % 8));
+    }
+
+    /**
+     * Shows the back frame starting from the next refresh cycle.
+     * The back frame must not be drawn again until ready() returns true.
+     */
+    static inline void commit() {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            _pending = true;
+        }
+    }
+
+    /** Whether the last committed frame is being displayed, so that the back frame can be drawn. */
+    static inline bool ready() {
+        return !_pending;
+    }
+
+    /** Shows the next row. Must be called from the compare match interrupt handler of channel A. */
+    static inline void refresh() {
+        uint8_t row = _row;
+
+        // Swap the frames only at the beginning of a cycle, to avoid tearing
+        if (row == 0 && _pending) {
+            _front ^= 1;
+            _pending = false;
+        }
+
+        Register::write(_frames[_front][row]);
+
+        _row = row == Rows - 1 ? 0 : row + 1;
+    }
+
+private:
+
+    // Rows are stored in transmission order, as expected by the registers
+    static inline uint8_t _frames[2][Rows][Bytes] = {};
+    static inline uint8_t _row = 0;
+    static inline volatile uint8_t _front = 0;
+    static inline volatile bool _pending = false;
+
+};
+
+} // namespace avr
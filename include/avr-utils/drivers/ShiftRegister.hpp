@@ -3,6 +3,9 @@
 #include <stddef.h>
 #include <inttypes.h>
 
+#include "avr-utils/utility.hpp"
+#include "avr-utils/spi.hpp"
+
 namespace avr {
 
 enum class ShiftDirection {
@@ -10,13 +13,50 @@ enum class ShiftDirection {
     MSBFirst
 };
 
+namespace detail {
+
+template <ShiftDirection Direction>
+static constexpr spi::SPIBitOrder spi_bit_order =
+    Direction == ShiftDirection::LSBFirst ? spi::SPIBitOrder::LSBFirst : spi::SPIBitOrder::MSBFirst;
+
+template <typename DataPin, typename ClockPin, ShiftDirection Direction, size_t... Is>
+__attribute__((always_inline))
+static inline uint8_t shift_in_bits(index_sequence<Is...>) {
+    uint8_t data = 0;
+
+    // Unrolled at compile time, the fold evaluates the bits in order
+    ([&data]() {
+        constexpr uint8_t bit = Direction == ShiftDirection::LSBFirst ? (1 << Is) : (0b10000000 >> Is);
+        if (DataPin::read()) {
+            data |= bit;
+        }
+        ClockPin::toggle();
+        ClockPin::toggle();
+    }(), ...);
+
+    return data;
+}
+
+} // namespace detail
+
+
+
 /**
  * Shift out function. Performance optimized of Arduino's default shiftOut.
- * This is only for LSB-First, and uses directly the ports of the chip.
+ * This uses directly the ports of the chip, or the SPI peripheral when the pins are MOSI and SCK
+ * and it has been enabled (for example by ShiftRegister::init()).
  */
 template <typename DataPin, typename ClockPin, ShiftDirection Direction = ShiftDirection::LSBFirst>
 inline static void shiftOut(const uint8_t data) {
 
+    if constexpr (spi::isSPI<DataPin, ClockPin>) {
+        if (spi::Master::enabled()) {
+            spi::Master::setBitOrder<detail::spi_bit_order<Direction>>();
+            spi::Master::write(data);
+            return;
+        }
+    }
+
     // Manually unrolled for loop
 
     if constexpr (Direction == ShiftDirection::LSBFirst) {
@@ -109,27 +149,132 @@ inline static void shiftOut(const uint8_t data) {
 
 
 
-/** Maintains the state of a simple 8 bit shift register. */
+/** Shifts out a sequence of bytes, starting from the first one. */
+template <typename DataPin, typename ClockPin, ShiftDirection Direction = ShiftDirection::LSBFirst>
+inline static void shiftOut(const uint8_t* data, size_t length) {
+
+    if constexpr (spi::isSPI<DataPin, ClockPin>) {
+        if (spi::Master::enabled()) {
+            spi::Master::setBitOrder<detail::spi_bit_order<Direction>>();
+            spi::Master::write(data, length);
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        shiftOut<DataPin, ClockPin, Direction>(data[i]);
+    }
+
+}
+
+
+
+/**
+ * Shift in function, the counterpart of shiftOut.
+ * The data pin is read before each clock pulse, as parallel-in registers like the 74HC165
+ * present the first bit right after loading.
+ * When the pins are MISO and SCK and the SPI peripheral is enabled, the byte is clocked in by it.
+ */
+template <typename DataPin, typename ClockPin, ShiftDirection Direction = ShiftDirection::MSBFirst>
+inline static uint8_t shiftIn() {
+
+    if constexpr (spi::isSPIInput<DataPin, ClockPin>) {
+        if (spi::Master::enabled()) {
+            spi::Master::setBitOrder<detail::spi_bit_order<Direction>>();
+            return spi::Master::transfer(0);
+        }
+    }
+
+    return detail::shift_in_bits<DataPin, ClockPin, Direction>(make_index_sequence<8>());
+}
+
+
+
+/**
+ * Maintains the state of a chain of 8 bit shift registers, daisy-chained so that all of them share the same latch.
+ * Byte 0 (and so bits 0-7) is the register directly connected to the microcontroller.
+ * When the data and clock pins are MOSI and SCK the bits are clocked out by the SPI peripheral,
+ * otherwise they are bit-banged.
+ */
 template <
     typename ClockPin,
     typename LatchPin,
     typename DataPin,
-    ShiftDirection Direction = ShiftDirection::LSBFirst
+    ShiftDirection Direction = ShiftDirection::LSBFirst,
+    size_t Bytes = 1
 >
 class ShiftRegister {
+
+    static_assert(Bytes > 0, "At least one register is required.");
+
 public:
 
-    /** Updates the state of all the outputs. */
+    static constexpr bool usesSPI = spi::isSPI<DataPin, ClockPin>;
+    static constexpr size_t bytes = Bytes;
+
+    /** Initializes the pins, and the SPI peripheral at full speed if it is used. */
+    static void init() {
+        if constexpr (usesSPI) {
+            spi::Master::init<spi::SPIClock::By2, detail::spi_bit_order<Direction>>();
+        } else {
+            DataPin::init();
+            ClockPin::init();
+        }
+        LatchPin::init();
+    }
+
+    /** Updates the state of all the outputs of a single register chain. */
     ShiftRegister& set(const uint8_t value) {
-        _value = value;
+        static_assert(Bytes == 1, "Use setByte() on a chain of registers.");
+        return setByte(0, value);
+    }
+
+    /** Updates the state of all the outputs of the i-th register. */
+    ShiftRegister& setByte(const size_t i, const uint8_t value) {
+        uint8_t& byte = byteAt(i);
+        _dirty |= byte != value;
+        byte = value;
         return *this;
     }
 
-    /** Updates the physical register to reflect the changes. */
+    ShiftRegister& setBit(const size_t bit) {
+        return setByte(bit / 8, getByte(bit / 8) | (1 << (bit % 8)));
+    }
+
+    ShiftRegister& clearBit(const size_t bit) {
+        return setByte(bit / 8, getByte(bit / 8) & ~(1 << (bit % 8)));
+    }
+
+    ShiftRegister& writeBit(const size_t bit, const bool value) {
+        return value ? setBit(bit) : clearBit(bit);
+    }
+
+    uint8_t getByte(const size_t i) const {
+        return _value[Bytes - 1 - i];
+    }
+
+    bool getBit(const size_t bit) const {
+        return (getByte(bit / 8) & (1 << (bit % 8))) != 0;
+    }
+
+    /** Updates the physical registers to reflect the changes, if there are any. */
     void update() const {
+        if (!_dirty) {
+            return;
+        }
+
+        write(_value);
+        _dirty = false;
+    }
 
-        // Send all the data
-        shiftOut<DataPin, ClockPin, Direction>(_value);
+    /**
+     * Shifts out a raw image of the whole chain, in transmission order (the last byte is the one of the
+     * first register), and latches it. The state held by the instance is not affected.
+     */
+    static void write(const uint8_t* data) {
+
+        // Send all the data, starting from the farthest register
+        shiftOut<DataPin, ClockPin, Direction>(data, Bytes);
 
         // Toggle latch
         LatchPin::toggle();
@@ -138,7 +283,123 @@ public:
     }
 
 private:
-    uint8_t _value = 0;
+
+    // Stored in transmission order, so the last byte is the one of the first register
+    uint8_t _value[Bytes] = {};
+    mutable bool _dirty = true;
+
+    uint8_t& byteAt(const size_t i) {
+        return _value[Bytes - 1 - i];
+    }
+
+};
+
+/**
+ * Reads a chain of 8 bit parallel-in shift registers (like the 74HC165), sharing the same load pin.
+ * Byte 0 (and so bits 0-7) is the register directly connected to the microcontroller.
+ * When the data and clock pins are MISO and SCK the bits are clocked in by the SPI peripheral,
+ * otherwise they are bit-banged.
+ *
+ * The inputs are debounced with vertical counters, working on a whole byte at a time:
+ * a bit changes its debounced state only after 4 consecutive samples with the new value,
+ * so update() should be called periodically, for example every few milliseconds.
+ */
+template <
+    typename ClockPin,
+    typename LoadPin,
+    typename DataPin,
+    ShiftDirection Direction = ShiftDirection::MSBFirst,
+    size_t Bytes = 1
+>
+class InputShiftRegister {
+
+    static_assert(Bytes > 0, "At least one register is required.");
+
+public:
+
+    static constexpr bool usesSPI = spi::isSPIInput<DataPin, ClockPin>;
+    static constexpr size_t bytes = Bytes;
+
+    /**
+     * Initializes the pins, and the SPI peripheral at full speed if it is used,
+     * then takes the first sample as the initial debounced state.
+     */
+    void init() {
+        if constexpr (usesSPI) {
+            spi::Master::init<spi::SPIClock::By2, detail::spi_bit_order<Direction>>();
+        } else {
+            ClockPin::init();
+            DataPin::init();
+        }
+        LoadPin::init();
+        LoadPin::set(); // The load pin is active low
+
+        sample(_state);
+        for (size_t i = 0; i < Bytes; ++i) {
+            _changed[i] = 0;
+            _count0[i] = 0xFF;
+            _count1[i] = 0xFF;
+        }
+    }
+
+    /** Reads the raw state of all the inputs, without debouncing. */
+    void sample(uint8_t* data) const {
+
+        // Latch the parallel inputs
+        LoadPin::unset();
+        LoadPin::set();
+
+        for (size_t i = 0; i < Bytes; ++i) {
+            data[i] = shiftIn<DataPin, ClockPin, Direction>();
+        }
+
+    }
+
+    /** Samples the inputs and updates the debounced state. Returns whether any input changed. */
+    bool update() {
+        uint8_t raw[Bytes];
+        sample(raw);
+
+        uint8_t any = 0;
+        for (size_t i = 0; i < Bytes; ++i) {
+            uint8_t delta = _state[i] ^ raw[i];
+
+            // Two bit vertical counter, reset for the bits equal to the debounced state
+            _count0[i] = ~(_count0[i] & delta);
+            _count1[i] = _count0[i] ^ (_count1[i] & delta);
+
+            // The bits whose counter rolled over change their state
+            delta &= _count0[i] & _count1[i];
+            _state[i] ^= delta;
+            _changed[i] = delta;
+            any |= delta;
+        }
+
+        return any != 0;
+    }
+
+    uint8_t getByte(const size_t i) const {
+        return _state[i];
+    }
+
+    bool getBit(const size_t bit) const {
+        return (_state[bit / 8] & (1 << (bit % 8))) != 0;
+    }
+
+    /** Bits of the i-th register that changed their debounced state in the last update. */
+    uint8_t getChangedByte(const size_t i) const {
+        return _changed[i];
+    }
+
+    bool hasChanged(const size_t bit) const {
+        return (_changed[bit / 8] & (1 << (bit % 8))) != 0;
+    }
+
+private:
+    uint8_t _state[Bytes] = {};
+    uint8_t _changed[Bytes] = {};
+    uint8_t _count0[Bytes] = {};
+    uint8_t _count1[Bytes] = {};
 };
 
-} // namespace avr
\ No newline at end of file
+} // namespace avr
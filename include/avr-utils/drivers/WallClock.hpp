@@ -0,0 +1,109 @@
+#pragma once
+
+#include <inttypes.h>
+#include <util/atomic.h>
+
+#include "avr-utils/Clock.hpp"
+#include "avr-utils/time.hpp"
+#include "avr-utils/drivers/DS1307_rtc.hpp"
+
+namespace avr {
+
+/**
+ * Wall-clock time kept in RAM, so that reading it does not need any I2C transaction.
+ * The time is read from the RTC once at init, and then extrapolated from Clock::millis(),
+ * whose drift with respect to the RTC is measured and corrected at every sync.
+ * The time never goes backwards: when the RTC is behind, the clock waits for it.
+ *
+ * For an exact phase, the 1Hz square wave of the RTC can be connected to an external interrupt,
+ * whose handler calls tick() on the falling edge, when the RTC seconds change:
+ *
+ *     ISR(INT0_vect) {
+ *         WallClock::tick();
+ *     }
+ *
+ *     Clock::init();
+ *     rtc.enableSquareWave();
+ *     WallClock::init(rtc, 3600); // Sync every hour
+ *
+ *     while (true) {
+ *         WallClock::update();
+ *         log(WallClock::now());
+ *     }
+ */
+class WallClock {
+public:
+
+    /** Minimum time between the first sync and the following ones to measure the drift. */
+    static constexpr uint32_t driftInterval = 900;
+
+    /** Reads the time from the RTC, and syncs again every syncInterval seconds from update() (if not 0). */
+    static void init(const RTC& rtc, uint32_t syncInterval = 0);
+
+    /** Reads the time from the RTC, correcting the drift of Clock. */
+    static void sync();
+
+    /** Syncs if the sync interval has elapsed. Must not be called from interrupt handlers. */
+    static void update();
+
+    /** Marks the beginning of an RTC second. Must be called from the handler of the square wave interrupt. */
+    static void tick();
+
+    static inline Timestamp now() {
+        Timestamp t;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            advance(Clock::millis() << 16);
+            t = _seconds;
+        }
+        return t;
+    }
+
+private:
+
+    // Times in milliseconds are fixed point values with 16 fractional bits
+    static constexpr uint32_t nominalStep = 1000UL << 16;
+
+    static const RTC* _rtc;
+    static uint32_t _syncInterval;
+    static uint32_t _lastSync;
+
+    static uint32_t _seconds;
+    static uint32_t _heldSeconds;
+    static uint64_t _next;
+    static uint32_t _step;
+
+    static uint64_t _anchorMs;
+    static uint32_t _anchorSeconds;
+
+    /**
+     * Counts the seconds elapsed up to the given time. Must be called with interrupts disabled,
+     * so it takes a bounded time even after a long gap: a single division instead of a step per second.
+     */
+    static inline void advance(uint64_t now) {
+        if (now < _next) {
+            return;
+        }
+
+        // Almost always a single second has elapsed, which does not need the 64 bit division
+        if (now - _next < _step) {
+            _next += _step;
+            count(1);
+        } else {
+            uint32_t n = (now - _next) / _step + 1;
+            _next += (uint64_t) n * _step;
+            count(n);
+        }
+    }
+
+    /** Counts n elapsed seconds, the first ones being absorbed by the seconds held while the RTC catches up. */
+    static inline void count(uint32_t n) {
+        if (n <= _heldSeconds) {
+            _heldSeconds -= n;
+        } else {
+            _seconds += n - _heldSeconds;
+            _heldSeconds = 0;
+        }
+    }
+};
+
+} // namespace avr
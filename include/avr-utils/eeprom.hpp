@@ -1,11 +1,126 @@
 #pragma once
 
 #include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include <string.h>
 #include <inttypes.h>
 
 #include "avr-utils/utility.hpp"
+#include "avr-utils/crc.hpp"
+
+#ifndef EEPROM_WRITE_QUEUE_SIZE
+#define EEPROM_WRITE_QUEUE_SIZE 32
+#endif
+
+ISR(EE_READY_vect);
 
 namespace avr {
+
+/**
+ * Background EEPROM writer driven by the EEPROM ready interrupt, so that slow writes do not stall the main loop.
+ * Bytes are queued and written strictly in order, one per interrupt, skipping the ones that are not changed:
+ * a commit marker (like a sequence number or a checksum) queued after the data it refers to
+ * is written only when all the data is, so a power failure never leaves a committed but incomplete record.
+ *
+ * Reads of the EEPROM, and blocking writes, must not happen while the writer is busy, so the blocking
+ * load() and store() of the storage classes and EEPROMIterator flush it first: code using avr-libc directly
+ * must call flush() too. Flushing does not link the writer in, so its queue and its interrupt
+ * take space only in the programs that actually queue some writes.
+ */
+class EEPROMWriter {
+public:
+
+    /**
+     * Queues a byte, waiting for space in the queue if it is full.
+     * With interrupts disabled, like in an ISR, the queue cannot drain by itself, so the oldest bytes are written
+     * synchronously to make space.
+     */
+    static void write(void* address, uint8_t value);
+
+    /** Queues a block of bytes, in order. */
+    static void write(void* address, const void* data, size_t size);
+
+    /** Whether some bytes are still queued or being written. */
+    static bool busy();
+
+    /** Waits until all the queued bytes have been written. */
+    static inline void flush() {
+        if (drain) {
+            drain();
+        }
+    }
+
+private:
+    // Weak, so that it resolves to null when nothing references the rest of the writer
+    __attribute__((weak)) static void drain();
+
+    static void writeNext();
+
+    static uint16_t _addresses[EEPROM_WRITE_QUEUE_SIZE];
+    static uint8_t _values[EEPROM_WRITE_QUEUE_SIZE];
+    static volatile uint8_t _head;
+    static volatile uint8_t _count;
+
+    friend void ::EE_READY_vect();
+};
+
+
+/**
+ * Random access iterator over the bytes of the EEPROM, so that values can be serialized directly into it.
+ * Writes use eeprom_update_byte, so unchanged bytes are not rewritten.
+ * Each access flushes EEPROMWriter first, so that it never races a background write.
+ */
+class EEPROMIterator {
+public:
+
+    /** Reference to a single byte of the EEPROM. */
+    class Reference {
+    public:
+        explicit Reference(uint8_t* address) : _address(address) {}
+
+        inline operator uint8_t() const {
+            EEPROMWriter::flush();
+            return eeprom_read_byte(_address);
+        }
+
+        inline Reference& operator=(uint8_t x) {
+            EEPROMWriter::flush();
+            eeprom_update_byte(_address, x);
+            return *this;
+        }
+
+    private:
+        uint8_t* _address;
+    };
+
+    explicit EEPROMIterator(void* address) : _address((uint8_t*) address) {}
+
+    inline bool operator==(const EEPROMIterator& other) const { return _address == other._address; }
+    inline bool operator!=(const EEPROMIterator& other) const { return _address != other._address; }
+
+    inline Reference operator*() const { return Reference(_address); }
+
+    inline EEPROMIterator& operator++() {
+        ++_address;
+        return *this;
+    }
+
+    inline EEPROMIterator operator++(int) {
+        return EEPROMIterator(_address++);
+    }
+
+    inline ptrdiff_t operator-(const EEPROMIterator& other) const {
+        return _address - other._address;
+    }
+
+private:
+    uint8_t* _address;
+};
+
+
+
 namespace detail {
 
 /** Functions to load and store raw values from the eeprom. */
@@ -43,22 +158,64 @@ AVR_UTILS_SPECIALIZE_ACCESSOR(int32_t, dword, uint32_t)
 
     
     
-/** Type-safe access to a value stored in the EEPROM. */
-template <typename T, typename Tag>
+/**
+ * Type-safe access to a value stored in the EEPROM, through a cache in RAM.
+ * store() writes back the whole cache, like it always did. The cache also keeps track of the chunks of ChunkSize bytes
+ * that are modified, so that storeDirty() writes back only those: fields set with set<&T::field>() or marked
+ * with markDirty<&T::field>() only dirty their own chunks, and assigning the whole value dirties all of them.
+ * Changes made in place through the mutable accessors are not tracked, so they need markDirty() or store().
+ */
+template <typename T, typename Tag, size_t ChunkSize = 8>
 class EEPROMStorage {
 public:
 
     static_assert(is_trivially_copyable_v<T>, "The type to be stored in the EEPROM must be trivially copyable.");
+    static_assert(ChunkSize > 0, "Invalid chunk size.");
 
     EEPROMStorage() {}
 
     inline EEPROMStorage& load() {
+        EEPROMWriter::flush();
         EEPROMStorageAccessor<T>::load((void*) &cache.bytes, (const void*) &data);
+        clearDirty();
         return *this;
     }
     
+    /** Writes back the whole value. */
     inline const EEPROMStorage& store() const {
+        EEPROMWriter::flush();
         EEPROMStorageAccessor<T>::store((const void*) &cache.bytes, (void*) &data);
+        clearDirty();
+        return *this;
+    }
+
+    /** Writes back only the modified chunks. */
+    inline const EEPROMStorage& storeDirty() const {
+        EEPROMWriter::flush();
+        if (allDirty()) {
+            EEPROMStorageAccessor<T>::store((const void*) &cache.bytes, (void*) &data);
+        } else {
+            forEachDirtyRange([this](size_t offset, size_t size) {
+                eeprom_update_block((const uint8_t*) &cache.bytes + offset, (uint8_t*) &data + offset, size);
+            });
+        }
+        clearDirty();
+        return *this;
+    }
+
+    /** Stores the whole value in background through EEPROMWriter, without waiting for the writes to complete. */
+    inline const EEPROMStorage& storeAsync() const {
+        EEPROMWriter::write((void*) &data, (const void*) &cache.bytes, sizeof(T));
+        clearDirty();
+        return *this;
+    }
+
+    /** Stores only the modified chunks in background through EEPROMWriter. */
+    inline const EEPROMStorage& storeDirtyAsync() const {
+        forEachDirtyRange([this](size_t offset, size_t size) {
+            EEPROMWriter::write((uint8_t*) &data + offset, (const uint8_t*) &cache.bytes + offset, size);
+        });
+        clearDirty();
         return *this;
     }
 
@@ -70,23 +227,403 @@ public:
         return &cache.obj;
     }
 
+    /** Read-only access to the cached value. */
+    inline const T& get() const {
+        return cache.obj;
+    }
+
     inline const T& operator=(const T& other) {
         cache.obj = other;
+        markDirty();
         return other;
     }
 
+    /** Sets a single field of the cached value. */
+    template <auto Member>
+    inline void set(const remove_reference_t<decltype(declval<T&>().*Member)>& value) {
+        // Copied as raw bytes, so that arrays can be set as well
+        memcpy(&(cache.obj.*Member), &value, sizeof(value));
+        markDirty<Member>();
+    }
+
+    /** Marks a field as modified, after changing it in place. */
+    template <auto Member>
+    inline void markDirty() {
+        markDirty((const uint8_t*) &(cache.obj.*Member) - (const uint8_t*) &cache.obj, sizeof(cache.obj.*Member));
+    }
+
+    /** Marks a range of bytes of the value as modified. */
+    inline void markDirty(size_t offset, size_t size) {
+        for (size_t i = offset / ChunkSize; i <= (offset + size - 1) / ChunkSize; ++i) {
+            _dirty[i / 8] |= (1 << (i % 8));
+        }
+    }
+
+    /** Marks the whole value as modified. */
+    inline void markDirty() {
+        for (size_t i = 0; i < sizeof(_dirty); ++i) {
+            _dirty[i] = 0xFF;
+        }
+    }
+
+    inline bool isDirty() const {
+        for (size_t i = 0; i < sizeof(_dirty); ++i) {
+            if (_dirty[i] != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Iterators over the raw bytes of the value in the EEPROM, to serialize other values directly into it
+
+    inline EEPROMIterator begin() const {
+        return EEPROMIterator((void*) &data);
+    }
+
+    inline EEPROMIterator end() const {
+        return EEPROMIterator((void*) (&data + 1));
+    }
+
 private:
     static T data;
+
+    static constexpr size_t Chunks = (sizeof(T) + ChunkSize - 1) / ChunkSize;
     
     union {
         T obj;
         typename aligned_storage<sizeof(T), alignof(T)>::type bytes;
     } cache;
+
+    // A bit for each chunk, set when it must be written back
+    mutable uint8_t _dirty[(Chunks + 7) / 8] = {};
+
+    inline bool isChunkDirty(size_t i) const {
+        return _dirty[i / 8] & (1 << (i % 8));
+    }
+
+    inline bool allDirty() const {
+        for (size_t i = 0; i < Chunks; ++i) {
+            if (!isChunkDirty(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline void clearDirty() const {
+        for (size_t i = 0; i < sizeof(_dirty); ++i) {
+            _dirty[i] = 0;
+        }
+    }
+
+    /** Calls f(offset, size) for each run of consecutive dirty chunks. */
+    template <typename F>
+    inline void forEachDirtyRange(F&& f) const {
+        size_t i = 0;
+        while (i < Chunks) {
+            if (!isChunkDirty(i)) {
+                ++i;
+                continue;
+            }
+
+            size_t first = i;
+            while (i < Chunks && isChunkDirty(i)) {
+                ++i;
+            }
+
+            size_t offset = first * ChunkSize;
+            size_t last = i * ChunkSize < sizeof(T) ? i * ChunkSize : sizeof(T);
+            f(offset, last - offset);
+        }
+    }
     
     EEPROMStorage(const EEPROMStorage&) = delete;
     EEPROMStorage(EEPROMStorage&&) = delete;
 };
 
+
+
+/**
+ * Value stored in the EEPROM rotating over a ring of records, to spread the wear of frequent stores over Slots cells.
+ * Each record has a sequence number, which is one more than the one of the previous record in the ring,
+ * except after the newest record: load() finds it with a binary search, and store() writes a single record after it.
+ */
+template <typename T, typename Tag, size_t Slots>
+class WearLeveledEEPROMStorage {
+public:
+
+    static_assert(is_trivially_copyable_v<T>, "The type to be stored in the EEPROM must be trivially copyable.");
+    static_assert(Slots >= 2 && Slots < 0xFFFF, "Between 2 and 65534 slots are supported.");
+
+    struct Record {
+        uint16_t sequence;
+        T value;
+    };
+
+    WearLeveledEEPROMStorage() {}
+
+    inline WearLeveledEEPROMStorage& load() {
+        EEPROMWriter::flush();
+        locate();
+        EEPROMStorageAccessor<T>::load((void*) &cache.bytes, (const void*) &data[_slot].value);
+        return *this;
+    }
+
+    inline WearLeveledEEPROMStorage& store() {
+        EEPROMWriter::flush();
+        if (_slot == noSlot) {
+            locate();
+        }
+
+        size_t slot = _slot == Slots - 1 ? 0 : _slot + 1;
+        ++_sequence;
+
+        // The sequence number is written last, so that the record becomes the newest only when it is complete
+        EEPROMStorageAccessor<T>::store((const void*) &cache.bytes, (void*) &data[slot].value);
+        eeprom_update_word(&data[slot].sequence, _sequence);
+
+        _slot = slot;
+        return *this;
+    }
+
+    /** Stores the value in background through EEPROMWriter, which keeps the order of the value and the sequence number. */
+    inline WearLeveledEEPROMStorage& storeAsync() {
+        if (_slot == noSlot) {
+            EEPROMWriter::flush();
+            locate();
+        }
+
+        size_t slot = _slot == Slots - 1 ? 0 : _slot + 1;
+        ++_sequence;
+
+        EEPROMWriter::write((void*) &data[slot].value, (const void*) &cache.bytes, sizeof(T));
+        EEPROMWriter::write((void*) &data[slot].sequence, (const void*) &_sequence, sizeof(_sequence));
+
+        _slot = slot;
+        return *this;
+    }
+
+    inline T& operator*() {
+        return cache.obj;
+    }
+
+    inline T* operator->() {
+        return &cache.obj;
+    }
+
+    inline const T& operator=(const T& other) {
+        cache.obj = other;
+        return other;
+    }
+
+private:
+    static Record data[Slots];
+
+    static constexpr size_t noSlot = Slots;
+
+    size_t _slot = noSlot;
+    uint16_t _sequence;
+
+    union {
+        T obj;
+        typename aligned_storage<sizeof(T), alignof(T)>::type bytes;
+    } cache;
+
+    static inline uint16_t sequenceAt(size_t slot) {
+        return eeprom_read_word(&data[slot].sequence);
+    }
+
+    /** Finds the newest record: the last one of the run of consecutive sequence numbers starting from the first slot. */
+    inline void locate() {
+        uint16_t first = sequenceAt(0);
+        size_t lo = 0, hi = Slots;
+        while (hi - lo > 1) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (static_cast<uint16_t>(sequenceAt(mid) - first) == mid) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        _slot = lo;
+        _sequence = static_cast<uint16_t>(first + lo);
+    }
+
+    WearLeveledEEPROMStorage(const WearLeveledEEPROMStorage&) = delete;
+    WearLeveledEEPROMStorage(WearLeveledEEPROMStorage&&) = delete;
+};
+
+
+
+/**
+ * Value stored in the EEPROM in two alternate records, each with a header and a CRC,
+ * so that a store interrupted by a power failure never corrupts the last stored value.
+ * Records written by a layout with a different version, or corrupted, are ignored,
+ * and load() falls back to the initial value, which is kept in the program memory.
+ */
+template <typename T, typename Tag, uint8_t Version>
+class CheckedEEPROMStorage {
+public:
+
+    static_assert(is_trivially_copyable_v<T>, "The type to be stored in the EEPROM must be trivially copyable.");
+
+    struct Record {
+        uint8_t magic;
+        uint8_t version;
+        uint8_t generation;
+        T value;
+        uint16_t crc;
+    };
+
+    CheckedEEPROMStorage() {}
+
+    /**
+     * Loads the newest valid record, or the initial value if there is none.
+     * Returns whether a valid record was found.
+     */
+    inline bool load() {
+        EEPROMWriter::flush();
+        locate();
+
+        if (_slot == noSlot) {
+            memcpy_P((void*) &cache.bytes, &defaults, sizeof(T));
+            return false;
+        }
+
+        EEPROMStorageAccessor<T>::load((void*) &cache.bytes, (const void*) &data[_slot].value);
+        return true;
+    }
+
+    /**
+     * Writes the value in the record which is not the newest valid one, with the CRC last.
+     * Without a previous load(), the records are validated first, so that the newest one is never overwritten.
+     */
+    inline CheckedEEPROMStorage& store() {
+        EEPROMWriter::flush();
+        if (!_located) {
+            locate();
+        }
+
+        uint8_t slot = nextSlot();
+        uint16_t crc = checksum();
+        eeprom_update_byte(&data[slot].magic, magic);
+        eeprom_update_byte(&data[slot].version, Version);
+        eeprom_update_byte(&data[slot].generation, _generation);
+        EEPROMStorageAccessor<T>::store((const void*) &cache.bytes, (void*) &data[slot].value);
+        eeprom_update_word(&data[slot].crc, crc);
+        return *this;
+    }
+
+    /** Stores the value in background through EEPROMWriter, which keeps the CRC last. */
+    inline CheckedEEPROMStorage& storeAsync() {
+        if (!_located) {
+            EEPROMWriter::flush();
+            locate();
+        }
+
+        uint8_t slot = nextSlot();
+        uint16_t crc = checksum();
+        EEPROMWriter::write(&data[slot].magic, magic);
+        EEPROMWriter::write(&data[slot].version, Version);
+        EEPROMWriter::write(&data[slot].generation, _generation);
+        EEPROMWriter::write((void*) &data[slot].value, (const void*) &cache.bytes, sizeof(T));
+        EEPROMWriter::write((void*) &data[slot].crc, (const void*) &crc, sizeof(crc));
+        return *this;
+    }
+
+    inline T& operator*() {
+        return cache.obj;
+    }
+
+    inline T* operator->() {
+        return &cache.obj;
+    }
+
+    inline const T& operator=(const T& other) {
+        cache.obj = other;
+        return other;
+    }
+
+private:
+    static Record data[2];
+    static const T defaults;
+
+    static constexpr uint8_t magic = 0x5A;
+    static constexpr uint8_t noSlot = 2;
+
+    bool _located = false;
+    uint8_t _slot = noSlot;
+    uint8_t _generation = 0;
+
+    union {
+        T obj;
+        typename aligned_storage<sizeof(T), alignof(T)>::type bytes;
+    } cache;
+
+    /** CRC of the header and of the given value. */
+    template <typename F>
+    static inline uint16_t checksum(uint8_t generation, F&& byteAt) {
+        uint16_t crc = CRC16CCITT::initial;
+        crc = CRC16CCITT::update(crc, magic);
+        crc = CRC16CCITT::update(crc, Version);
+        crc = CRC16CCITT::update(crc, generation);
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            crc = CRC16CCITT::update(crc, byteAt(i));
+        }
+        return crc;
+    }
+
+    /** CRC of the cached value, to be stored with the current generation. */
+    inline uint16_t checksum() const {
+        const uint8_t* bytes = (const uint8_t*) &cache.bytes;
+        return checksum(_generation, [bytes](size_t i) { return bytes[i]; });
+    }
+
+    /** Selects the slot to write and advances the generation. */
+    inline uint8_t nextSlot() {
+        _slot = _slot == 0 ? 1 : 0;
+        ++_generation;
+        return _slot;
+    }
+
+    /** Validates a record reading it straight from the EEPROM, without touching the cache. */
+    static inline bool isValid(uint8_t slot) {
+        if (eeprom_read_byte(&data[slot].magic) != magic || eeprom_read_byte(&data[slot].version) != Version) {
+            return false;
+        }
+
+        const uint8_t* value = (const uint8_t*) &data[slot].value;
+        uint16_t crc = checksum(eeprom_read_byte(&data[slot].generation), [value](size_t i) {
+            return eeprom_read_byte(value + i);
+        });
+        return eeprom_read_word(&data[slot].crc) == crc;
+    }
+
+    /** Finds the newest valid record and its generation. */
+    inline void locate() {
+        bool valid0 = isValid(0);
+        bool valid1 = isValid(1);
+        uint8_t g0 = eeprom_read_byte(&data[0].generation);
+        uint8_t g1 = eeprom_read_byte(&data[1].generation);
+
+        // Generations wrap around, so the newest is the one ahead of the other
+        if (valid0 && valid1) {
+            _slot = static_cast<int8_t>(g1 - g0) > 0 ? 1 : 0;
+        } else if (valid0 || valid1) {
+            _slot = valid1 ? 1 : 0;
+        } else {
+            _slot = noSlot;
+        }
+
+        _generation = _slot == noSlot ? 0 : _slot == 0 ? g0 : g1;
+        _located = true;
+    }
+
+    CheckedEEPROMStorage(const CheckedEEPROMStorage&) = delete;
+    CheckedEEPROMStorage(CheckedEEPROMStorage&&) = delete;
+};
+
 } // namespace detail
 } // namespace avr
 
@@ -103,3 +640,32 @@ private:
     }                                                                                    \
     avr::detail::__eeprom__type__ ## name name;                                          \
     template<> type avr::detail::__eeprom__type__ ## name ::data EEMEM = initialValue;
+
+
+
+#define WearLeveledEEPROMStorage(type, name, slots, initialValue)                                           \
+    namespace avr {                                                                                         \
+    namespace detail {                                                                                      \
+        struct __eeprom__tag__ ## name;                                                                     \
+        using __eeprom__type__ ## name = WearLeveledEEPROMStorage<type, __eeprom__tag__ ## name, slots>;    \
+    }                                                                                                       \
+    }                                                                                                       \
+    avr::detail::__eeprom__type__ ## name name;                                                             \
+    /* Only the first record is initialized, the others have sequence number 0 and are older */            \
+    template<> avr::detail::__eeprom__type__ ## name ::Record                                               \
+        avr::detail::__eeprom__type__ ## name ::data[slots] EEMEM = { { 0, initialValue } };
+
+
+
+#define CheckedEEPROMStorage(type, name, version, initialValue)                                             \
+    namespace avr {                                                                                         \
+    namespace detail {                                                                                      \
+        struct __eeprom__tag__ ## name;                                                                     \
+        using __eeprom__type__ ## name = CheckedEEPROMStorage<type, __eeprom__tag__ ## name, version>;      \
+    }                                                                                                       \
+    }                                                                                                       \
+    avr::detail::__eeprom__type__ ## name name;                                                             \
+    /* Both records start invalid, so the initial value is loaded until the first store */                  \
+    template<> avr::detail::__eeprom__type__ ## name ::Record                                               \
+        avr::detail::__eeprom__type__ ## name ::data[2] EEMEM = {};                                         \
+    template<> const type avr::detail::__eeprom__type__ ## name ::defaults PROGMEM = initialValue;
@@ -3,24 +3,29 @@
 #include <inttypes.h>
 #include <avr/interrupt.h>
 
+#include "avr-utils/Function.hpp"
+
 ISR(TWI_vect);
 
 namespace avr {
 namespace i2c {
 
-/** I2C slave interface based on callbacks. */
+/** I2C slave interface based on callbacks, which can carry their own context (like lambdas with captures). */
 class Slave {
 public:
 
-    static void onDataReceived(void (*)(uint8_t data));
-    static void onDataRequested(uint8_t (*)());
+    using DataReceivedCallback = Function<void(uint8_t data)>;
+    using DataRequestedCallback = Function<uint8_t()>;
+
+    static void onDataReceived(DataReceivedCallback f);
+    static void onDataRequested(DataRequestedCallback f);
 
     static void init(uint8_t address);
     static void stop();
 
 private:
-    static void (*__onDataReceived)(uint8_t);
-    static uint8_t (*__onDataRequested)();
+    static DataReceivedCallback __onDataReceived;
+    static DataRequestedCallback __onDataRequested;
 
     friend void ::TWI_vect();
 };
@@ -22,7 +22,20 @@ enum class TimerMode {
     ClearTimerOnCompareMatch,
     FastPWM,
     PhaseCorrectPWM,
-    PhaseFrequencyCorrectPWM
+    PhaseFrequencyCorrectPWM,
+
+    // The following modes are available only on 16 bit timers.
+    // The suffix indicates what defines the TOP value of the counter.
+    FastPWM8Bit,
+    FastPWM9Bit,
+    FastPWM10Bit,
+    FastPWMICR,
+    PhaseCorrectPWM8Bit,
+    PhaseCorrectPWM9Bit,
+    PhaseCorrectPWM10Bit,
+    PhaseCorrectPWMICR,
+    PhaseFrequencyCorrectPWMICR,
+    ClearTimerOnCompareMatchICR
 };
 
 enum class TimerPrescaler {
@@ -45,5 +58,6 @@ enum class TimerChannel {
 template <Port P>               struct port_traits;
 template <int I>                struct timer_traits;
 template <Port P, uint8_t Mask> struct timer_for_pin;
+                                struct spi_traits;
 
 } // namespace
\ No newline at end of file
@@ -24,6 +24,7 @@ template <int> class Timer;
         static volatile ValueType& outputCompareRegisterA() { return OCR ## i ## A; }     \
         static volatile ValueType& outputCompareRegisterB() { return OCR ## i ## B; }     \
         static volatile uint8_t& interruptMaskRegister() { return TIMSK ## i; }           \
+        static volatile uint8_t& generalControlRegister() { return GTCCR; }               \
                                                                                           \
         /* Some constants to easily access those macros irrespectively of the timer */    \
         static constexpr unsigned int COMA0 = COM  ## i ## A0;                            \
@@ -33,126 +34,188 @@ template <int> class Timer;
         static constexpr unsigned int TOIE  = TOIE ## i;                                  \
         static constexpr unsigned int OCIEA = OCIE ## i ## A;                             \
         static constexpr unsigned int OCIEB = OCIE ## i ## B;                             \
+        static constexpr unsigned int SYNC  = TSM;                                        \
                                                                                           \
         /* Additional members that contains mappings for modes and prescalers. */         \
         modes                                                                             \
         prescalers                                                                        \
+                                                                                          \
+        /* Generic register manipulation built on top of the mappings above */            \
+        template <TimerMode Mode>                                                         \
+        static inline void setMode() {                                                    \
+            controlRegisterA() = (controlRegisterA() & ~modeMaskA) | modeBitsA<Mode>();   \
+            controlRegisterB() = (controlRegisterB() & ~modeMaskB) | modeBitsB<Mode>();   \
+        }                                                                                 \
+                                                                                          \
+        template <TimerPrescaler Prescaler>                                               \
+        static inline void setPrescaler() {                                               \
+            uint8_t reg = controlRegisterB() & ~prescalerMask;                            \
+            controlRegisterB() = reg | prescalerBits<Prescaler>();                        \
+        }                                                                                 \
     };
 
 #define AVR_UTILS_NORMAL_MODES(i)                                                         \
-    template <TimerMode Mode>                                                             \
-    static inline void setMode() {                                                        \
+    /* Mode used for the pins attached to this timer configured as PinMode::PWM */        \
+    static constexpr TimerMode pwmMode = TimerMode::FastPWM;                              \
                                                                                           \
-        uint8_t reg = controlRegisterA();                                                 \
+    /* Maps a mode to the value of the WGM bits as reported in the datasheet */           \
+    template <TimerMode Mode>                                                             \
+    static constexpr uint8_t waveformGenerationMode() {                                   \
         if constexpr (Mode == TimerMode::Normal) {                                        \
-            reg &= ~( (1 << WGM ## i ## 0) | (1 << WGM ## i ## 1) );                      \
+            return 0;                                                                     \
         } else if constexpr (Mode == TimerMode::ClearTimerOnCompareMatch) {               \
-            reg &= ~(1 << WGM ## i ## 0);                                                 \
-            reg |=  (1 << WGM ## i ## 1);                                                 \
+            return 2;                                                                     \
         } else if constexpr (Mode == TimerMode::FastPWM) {                                \
-            reg |= (1 << WGM ## i ## 0) | (1 << WGM ## i ## 1);                           \
+            return 3;                                                                     \
         } else if constexpr (Mode == TimerMode::PhaseCorrectPWM) {                        \
-            reg &= ~(1 << WGM ## i ## 1);                                                 \
-            reg |=  (1 << WGM ## i ## 0);                                                 \
+            return 1;                                                                     \
         } else {                                                                          \
             static_assert(Mode != Mode, "Unsupported mode for timer " #i "." );           \
         }                                                                                 \
-        controlRegisterA() = reg;                                                         \
+    }                                                                                     \
+                                                                                          \
+    /* Spreads the WGM bits over the two control registers */                             \
+    static constexpr uint8_t modeMaskA = (1 << WGM ## i ## 0) | (1 << WGM ## i ## 1);     \
+    static constexpr uint8_t modeMaskB = (1 << WGM ## i ## 2);                            \
                                                                                           \
+    template <TimerMode Mode>                                                             \
+    static constexpr uint8_t modeBitsA() {                                                \
+        constexpr uint8_t wgm = waveformGenerationMode<Mode>();                           \
+        return ((wgm & 1) << WGM ## i ## 0) | (((wgm >> 1) & 1) << WGM ## i ## 1);        \
+    }                                                                                     \
+                                                                                          \
+    template <TimerMode Mode>                                                             \
+    static constexpr uint8_t modeBitsB() {                                                \
         /* Irrespectively of the mode, this bit is always set to zero */                  \
-        controlRegisterB() &= ~(1 << WGM ## i ## 2);                                      \
+        return 0;                                                                         \
     }
 
 #define AVR_UTILS_EXTENDED_MODES(i)                                                       \
-    template <TimerMode Mode>                                                             \
-    static inline void setMode() {                                                        \
-        uint8_t regA = controlRegisterA();                                                \
-        uint8_t regB = controlRegisterB();                                                \
+    static volatile ValueType& inputCaptureRegister() { return ICR ## i; }                \
                                                                                           \
+    /* The generic PWM modes use OCRnA as TOP, so 8 bit PWM needs its own mode */         \
+    static constexpr TimerMode pwmMode = TimerMode::FastPWM8Bit;                          \
+                                                                                          \
+    /* Maps a mode to the value of the WGM bits as reported in the datasheet */           \
+    template <TimerMode Mode>                                                             \
+    static constexpr uint8_t waveformGenerationMode() {                                   \
         if constexpr (Mode == TimerMode::Normal) {                                        \
-            regA &= ~( (1 << WGM ## i ## 0) | (1 << WGM ## i ## 1) );                     \
-            regB &= ~( (1 << WGM ## i ## 2) | (1 << WGM ## i ## 3) );                     \
+            return 0;                                                                     \
+        } else if constexpr (Mode == TimerMode::PhaseCorrectPWM8Bit) {                    \
+            return 1;                                                                     \
+        } else if constexpr (Mode == TimerMode::PhaseCorrectPWM9Bit) {                    \
+            return 2;                                                                     \
+        } else if constexpr (Mode == TimerMode::PhaseCorrectPWM10Bit) {                   \
+            return 3;                                                                     \
         } else if constexpr (Mode == TimerMode::ClearTimerOnCompareMatch) {               \
-            regA &= ~( (1 << WGM ## i ## 0) | (1 << WGM ## i ## 1) );                     \
-            regB &= ~(1 << WGM ## i ## 3);                                                \
-            regB |= (1 << WGM ## i ## 2);                                                 \
-        } else if constexpr (Mode == TimerMode::FastPWM) {                                \
-            regA |= (1 << WGM ## i ## 0) | (1 << WGM ## i ## 1);                          \
-            regB |= (1 << WGM ## i ## 2) | (1 << WGM ## i ## 3);                          \
-        } else if constexpr (Mode == TimerMode::PhaseCorrectPWM) {                        \
-            regA |= (1 << WGM ## i ## 0) | (1 << WGM ## i ## 1);                          \
-            regB &= ~(1 << WGM ## i ## 2);                                                \
-            regB |= (1 << WGM ## i ## 3);                                                 \
+            return 4;                                                                     \
+        } else if constexpr (Mode == TimerMode::FastPWM8Bit) {                            \
+            return 5;                                                                     \
+        } else if constexpr (Mode == TimerMode::FastPWM9Bit) {                            \
+            return 6;                                                                     \
+        } else if constexpr (Mode == TimerMode::FastPWM10Bit) {                           \
+            return 7;                                                                     \
+        } else if constexpr (Mode == TimerMode::PhaseFrequencyCorrectPWMICR) {            \
+            return 8;                                                                     \
         } else if constexpr (Mode == TimerMode::PhaseFrequencyCorrectPWM) {               \
-            regA &= ~(1 << WGM ## i ## 1);                                                \
-            regA |= (1 << WGM ## i ## 0);                                                 \
-            regB &= ~(1 << WGM ## i ## 2);                                                \
-            regB |= (1 << WGM ## i ## 3);                                                 \
+            return 9;                                                                     \
+        } else if constexpr (Mode == TimerMode::PhaseCorrectPWMICR) {                     \
+            return 10;                                                                    \
+        } else if constexpr (Mode == TimerMode::PhaseCorrectPWM) {                        \
+            return 11;                                                                    \
+        } else if constexpr (Mode == TimerMode::ClearTimerOnCompareMatchICR) {            \
+            return 12;                                                                    \
+        } else if constexpr (Mode == TimerMode::FastPWMICR) {                             \
+            return 14;                                                                    \
+        } else if constexpr (Mode == TimerMode::FastPWM) {                                \
+            return 15;                                                                    \
         } else {                                                                          \
             static_assert(Mode != Mode, "Unsupported mode for timer " #i "." );           \
         }                                                                                 \
+    }                                                                                     \
+                                                                                          \
+    /* Spreads the WGM bits over the two control registers */                             \
+    static constexpr uint8_t modeMaskA = (1 << WGM ## i ## 0) | (1 << WGM ## i ## 1);     \
+    static constexpr uint8_t modeMaskB = (1 << WGM ## i ## 2) | (1 << WGM ## i ## 3);     \
                                                                                           \
-        controlRegisterA() = regA;                                                        \
-        controlRegisterB() = regB;                                                        \
+    template <TimerMode Mode>                                                             \
+    static constexpr uint8_t modeBitsA() {                                                \
+        constexpr uint8_t wgm = waveformGenerationMode<Mode>();                           \
+        return ((wgm & 1) << WGM ## i ## 0) | (((wgm >> 1) & 1) << WGM ## i ## 1);        \
+    }                                                                                     \
+                                                                                          \
+    template <TimerMode Mode>                                                             \
+    static constexpr uint8_t modeBitsB() {                                                \
+        constexpr uint8_t wgm = waveformGenerationMode<Mode>();                           \
+        return (((wgm >> 2) & 1) << WGM ## i ## 2) | (((wgm >> 3) & 1) << WGM ## i ## 3); \
     }
 
 #define AVR_UTILS_NORMAL_PRESCALERS(i)                                                          \
+    /* Timers with the synchronous prescaler share it, and its reset bit */                     \
+    static constexpr unsigned int PSR = PSRSYNC;                                                \
+                                                                                                \
+    /* Maps a prescaler to the value of the CS bits as reported in the datasheet */             \
     template <TimerPrescaler Prescaler>                                                         \
-    static inline void setPrescaler() {                                                         \
-        uint8_t reg = controlRegisterB();                                                       \
+    static constexpr uint8_t clockSelect() {                                                    \
         if constexpr (Prescaler == TimerPrescaler::Off) {                                       \
-            reg &= ~( (1 << CS ## i ## 0) | (1 << CS ## i ## 1) | (1 << CS ## i ## 2) );        \
+            return 0;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::NoPrescaler) {                        \
-            reg &= ~( (1 << CS ## i ## 1) | (1 << CS ## i ## 2) );                              \
-            reg |= (1 << CS ## i ## 0);                                                         \
+            return 1;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By8) {                                \
-            reg &= ~( (1 << CS ## i ## 0) | (1 << CS ## i ## 2) );                              \
-            reg |= (1 << CS ## i ## 1);                                                         \
+            return 2;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By64) {                               \
-            reg &= ~(1 << CS ## i ## 2);                                                        \
-            reg |= (1 << CS ## i ## 0) | (1 << CS ## i ## 1);                                   \
+            return 3;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By256) {                              \
-            reg &= ~( (1 << CS ## i ## 0) | (1 << CS ## i ## 1) );                              \
-            reg |= (1 << CS ## i ## 2);                                                         \
+            return 4;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By1024) {                             \
-            reg &= ~(1 << CS ## i ## 1);                                                        \
-            reg |= (1 << CS ## i ## 0) | (1 << CS ## i ## 2);                                   \
+            return 5;                                                                           \
         } else {                                                                                \
             static_assert(Prescaler != Prescaler, "Unsupported prescaler for timer " #i ".");   \
         }                                                                                       \
-        controlRegisterB() = reg;                                                               \
+    }                                                                                           \
+                                                                                                \
+    static constexpr uint8_t prescalerMask =                                                    \
+        (1 << CS ## i ## 0) | (1 << CS ## i ## 1) | (1 << CS ## i ## 2);                        \
+                                                                                                \
+    template <TimerPrescaler Prescaler>                                                         \
+    static constexpr uint8_t prescalerBits() {                                                  \
+        return clockSelect<Prescaler>() << CS ## i ## 0; /* The CS bits are contiguous */       \
     }
 
 #define AVR_UTILS_EXTENDED_PRESCALERS(i)                                                        \
+    /* This timer has its own asynchronous prescaler, with its own reset bit */                 \
+    static constexpr unsigned int PSR = PSRASY;                                                 \
+                                                                                                \
+    /* Maps a prescaler to the value of the CS bits as reported in the datasheet */             \
     template <TimerPrescaler Prescaler>                                                         \
-    static inline void setPrescaler() {                                                         \
-        uint8_t reg = controlRegisterB();                                                       \
+    static constexpr uint8_t clockSelect() {                                                    \
         if constexpr (Prescaler == TimerPrescaler::Off) {                                       \
-            reg &= ~( (1 << CS ## i ## 0) | (1 << CS ## i ## 1) | (1 << CS ## i ## 2) );        \
+            return 0;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::NoPrescaler) {                        \
-            reg &= ~( (1 << CS ## i ## 1) | (1 << CS ## i ## 2) );                              \
-            reg |= (1 << CS ## i ## 0);                                                         \
+            return 1;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By8) {                                \
-            reg &= ~( (1 << CS ## i ## 0) | (1 << CS ## i ## 2) );                              \
-            reg |= (1 << CS ## i ## 1);                                                         \
+            return 2;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By32) {                               \
-            reg &= ~(1 << CS ## i ## 2);                                                        \
-            reg |= (1 << CS ## i ## 0) | (1 << CS ## i ## 1);                                   \
+            return 3;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By64) {                               \
-            reg &= ~( (1 << CS ## i ## 0) | (1 << CS ## i ## 1) );                              \
-            reg |= (1 << CS ## i ## 2);                                                         \
+            return 4;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By128) {                              \
-            reg &= ~(1 << CS ## i ## 1);                                                        \
-            reg |= (1 << CS ## i ## 0) | (1 << CS ## i ## 2);                                   \
+            return 5;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By256) {                              \
-            reg &= ~(1 << CS ## i ## 0);                                                        \
-            reg |= (1 << CS ## i ## 1) | (1 << CS ## i ## 2);                                   \
+            return 6;                                                                           \
         } else if constexpr (Prescaler == TimerPrescaler::By1024) {                             \
-            reg |= (1 << CS ## i ## 0) | (1 << CS ## i ## 1) | (1 << CS ## i ## 2);             \
+            return 7;                                                                           \
         } else {                                                                                \
             static_assert(Prescaler != Prescaler, "Unsupported prescaler for timer " #i ".");   \
         }                                                                                       \
-        controlRegisterB() = reg;                                                               \
+    }                                                                                           \
+                                                                                                \
+    static constexpr uint8_t prescalerMask =                                                    \
+        (1 << CS ## i ## 0) | (1 << CS ## i ## 1) | (1 << CS ## i ## 2);                        \
+                                                                                                \
+    template <TimerPrescaler Prescaler>                                                         \
+    static constexpr uint8_t prescalerBits() {                                                  \
+        return clockSelect<Prescaler>() << CS ## i ## 0; /* The CS bits are contiguous */       \
     }
 
 AVR_UTILS_SPECIALIZE_TIMER_TRAITS(
@@ -192,6 +255,18 @@ AVR_UTILS_TIMER_FOR_PIN(2, B, D, 3);
 
 
 
+// SPI pins
+
+struct spi_traits {
+    static constexpr Port port = Port::B;
+    static constexpr uint8_t ssPin   = 2;
+    static constexpr uint8_t mosiPin = 3;
+    static constexpr uint8_t misoPin = 4;
+    static constexpr uint8_t sckPin  = 5;
+};
+
+
+
 // Clean up a bit
 #undef AVR_UTILS_SPECIALIZE_TIMER_TRAITS
 #undef AVR_UTILS_NORMAL_MODES
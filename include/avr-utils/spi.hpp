@@ -0,0 +1,119 @@
+#pragma once
+
+#include <inttypes.h>
+#include <avr/io.h>
+
+#include "avr-utils/private/device.hpp"
+#include "avr-utils/Pin.hpp"
+
+namespace avr {
+namespace spi {
+
+enum class SPIClock : uint8_t {
+    By2,
+    By4,
+    By8,
+    By16,
+    By32,
+    By64,
+    By128
+};
+
+enum class SPIBitOrder : uint8_t {
+    MSBFirst,
+    LSBFirst
+};
+
+/** Clock polarity and phase, with the usual numbering (mode 0 samples on the rising edge of an idle low clock). */
+enum class SPIMode : uint8_t {
+    Mode0,
+    Mode1,
+    Mode2,
+    Mode3
+};
+
+using SSPin   = Pin<spi_traits::port, spi_traits::ssPin,   PinMode::Output>;
+using MOSIPin = Pin<spi_traits::port, spi_traits::mosiPin, PinMode::Output>;
+using MISOPin = Pin<spi_traits::port, spi_traits::misoPin, PinMode::Input>;
+using SCKPin  = Pin<spi_traits::port, spi_traits::sckPin,  PinMode::Output>;
+
+/** Whether the given pins are wired to the SPI data output and clock. */
+template <typename DataPin, typename ClockPin>
+static constexpr bool isSPI =
+    DataPin::port == spi_traits::port && DataPin::mask == (1 << spi_traits::mosiPin) &&
+    ClockPin::port == spi_traits::port && ClockPin::mask == (1 << spi_traits::sckPin);
+
+/** Whether the given pins are wired to the SPI data input and clock. */
+template <typename DataPin, typename ClockPin>
+static constexpr bool isSPIInput =
+    DataPin::port == spi_traits::port && DataPin::mask == (1 << spi_traits::misoPin) &&
+    ClockPin::port == spi_traits::port && ClockPin::mask == (1 << spi_traits::sckPin);
+
+class Master {
+public:
+
+    /**
+     * Enables the SPI peripheral in master mode.
+     * The SS pin is configured as an output, since pulling it low while it is an input
+     * would silently switch the peripheral to slave mode.
+     */
+    template <
+        SPIClock Clock = SPIClock::By2,
+        SPIBitOrder Order = SPIBitOrder::MSBFirst,
+        SPIMode Mode = SPIMode::Mode0
+    >
+    static inline void init() {
+        SSPin::init();
+        MOSIPin::init();
+        SCKPin::init();
+        MISOPin::init();
+
+        // Each value of SPR1:0 selects a pair of dividers, the faster one with the double speed bit set
+        constexpr uint8_t divider = (uint8_t) Clock;
+        constexpr uint8_t rate = divider / 2;
+        constexpr bool doubleSpeed = (divider & 1) == 0 && Clock != SPIClock::By128;
+
+        SPCR = (1 << SPE) | (1 << MSTR) |
+            (Order == SPIBitOrder::LSBFirst ? (1 << DORD) : 0) |
+            ((uint8_t) Mode << CPHA) |
+            (rate << SPR0);
+        SPSR = doubleSpeed ? (1 << SPI2X) : 0;
+    }
+
+    static inline void stop() {
+        SPCR = 0;
+    }
+
+    static inline bool enabled() {
+        return (SPCR & (1 << SPE)) != 0;
+    }
+
+    template <SPIBitOrder Order>
+    static inline void setBitOrder() {
+        if constexpr (Order == SPIBitOrder::LSBFirst) {
+            SPCR |= (1 << DORD);
+        } else {
+            SPCR &= ~(1 << DORD);
+        }
+    }
+
+    /** Sends a byte and returns the one received at the same time. */
+    static inline uint8_t transfer(uint8_t data) {
+        SPDR = data;
+        while (!(SPSR & (1 << SPIF)));
+        return SPDR;
+    }
+
+    static inline void write(uint8_t data) {
+        SPDR = data;
+        while (!(SPSR & (1 << SPIF)));
+    }
+
+    // Bulk operations
+    static void transfer(uint8_t* data, uint16_t length);
+    static void write(const uint8_t* data, uint16_t length);
+
+};
+
+} // namespace spi
+} // namespace avr
@@ -8,6 +8,8 @@ namespace avr {
 struct Timestamp;
 struct DateTime;
 
+static constexpr uint32_t secondsPerDay = 86400UL;
+
 
 
 /**
@@ -19,16 +21,27 @@ struct Timestamp {
 
     Timestamp() = default;
 
-    Timestamp(uint32_t t)
+    constexpr Timestamp(uint32_t t)
         : timestamp(t)
     {
     }
 
     /** Constructs this timestap from the given human-readable DateTime representation. */
-    Timestamp(const DateTime& dt);
+    constexpr Timestamp(const DateTime& dt);
+
+    /** Days since the epoch. */
+    constexpr uint16_t days() const {
+        return timestamp / secondsPerDay;
+    }
+
+    /** Day of the week, from 0 (Sunday) to 6 (Saturday). */
+    constexpr uint8_t dayOfWeek() const {
+        // Jan 1 2000 was a Saturday
+        return (days() + 6) % 7;
+    }
 
     /** Expands this timestamp into a human-readable DateTime representation. */
-    inline DateTime toDateTime() const;
+    inline constexpr DateTime toDateTime() const;
 
     // Comparison operators
     bool operator==(const Timestamp& other) const { return timestamp == other.timestamp; }
@@ -52,7 +65,10 @@ struct Timestamp {
 
 
 
-/** Very basic DateTime structure to represent a time istant. */
+/**
+ * Very basic DateTime structure to represent a time istant, between 2000 and 2136.
+ * Months and days start from 1, like in the DS1307.
+ */
 struct DateTime {
     unsigned int year;
     unsigned char month;
@@ -63,7 +79,7 @@ struct DateTime {
 
     DateTime() = default;
 
-    DateTime(
+    constexpr DateTime(
         unsigned int y, unsigned char mo, unsigned char d,
         unsigned char h = 0 , unsigned char mi = 0, unsigned char s = 0
     )
@@ -77,10 +93,16 @@ struct DateTime {
     }
 
     /** Constructs a new DateTime equal to the given timestamp. */
-    DateTime(const Timestamp& ts);
+    constexpr DateTime(const Timestamp& ts);
 
     /** Returns the timestamp equivalent to this DateTime. */
-    inline Timestamp toTimestamp() const;
+    inline constexpr Timestamp toTimestamp() const;
+
+    /** Day of the week, from 0 (Sunday) to 6 (Saturday). */
+    inline constexpr uint8_t dayOfWeek() const;
+
+    /** Day of the year, from 1 to 366. */
+    inline constexpr uint16_t dayOfYear() const;
 
     // Make this structure serializable
     using Serializer = avr::Serializer<
@@ -95,7 +117,85 @@ struct DateTime {
 };
 
 
-DateTime Timestamp::toDateTime() const { return DateTime(*this); }
-Timestamp DateTime::toTimestamp() const { return Timestamp(*this); }
+namespace __detail {
+
+// Calendar arithmetic on 16 bit day numbers, without tables nor struct tm.
+// Years start on March 1st, so that the leap day is the last day of the year,
+// and the days before each month follow (153 * month + 2) / 5, with month 0 being March.
+// Year 0 starts on Mar 1 1999, 306 days before the epoch, and the range ends in 2136,
+// so 2100 is the only year divisible by 100 to take into account.
+
+static constexpr uint16_t daysBeforeEpoch = 306;
+
+/** Days from Mar 1 1999 to Mar 1 of the given (March-based) year. */
+constexpr uint16_t days_before_year(uint8_t year) {
+    return 365U * year + (year + 3) / 4 - (year > 100 ? 1 : 0);
+}
+
+/** Days from Mar 1 to the first of the given month, with month 0 being March. */
+constexpr uint16_t days_before_month(uint8_t month) {
+    return (153U * month + 2) / 5;
+}
+
+/** Days since the epoch of the given date. */
+constexpr uint16_t days_from_civil(unsigned int y, uint8_t m, uint8_t d) {
+    uint8_t year = y - 1999 - (m <= 2 ? 1 : 0);
+    uint8_t month = m > 2 ? m - 3 : m + 9;
+    return days_before_year(year) + days_before_month(month) + d - 1 - daysBeforeEpoch;
+}
+
+/** Date of the given number of days since the epoch. */
+constexpr DateTime civil_from_days(uint16_t days) {
+    uint16_t z = days + daysBeforeEpoch;
+
+    // The estimate is off by at most a year, since there are less than 365 leap days in the range
+    uint8_t year = z / 365;
+    if (days_before_year(year) > z) {
+        --year;
+    }
+
+    uint16_t doy = z - days_before_year(year);
+    uint8_t month = (5 * doy + 2) / 153;
+    uint8_t d = doy - days_before_month(month) + 1;
+    uint8_t m = month < 10 ? month + 3 : month - 9;
+
+    return DateTime(1999 + year + (m <= 2 ? 1 : 0), m, d);
+}
+
+} // namespace __detail
+
+
+
+constexpr Timestamp::Timestamp(const DateTime& dt)
+    : timestamp(
+        __detail::days_from_civil(dt.year, dt.month, dt.day) * secondsPerDay +
+        static_cast<uint32_t>(static_cast<uint16_t>(dt.hours * 60U + dt.minutes)) * 60U + dt.seconds
+    )
+{
+}
+
+constexpr DateTime::DateTime(const Timestamp& ts)
+    : DateTime(__detail::civil_from_days(ts.days()))
+{
+    // Split the seconds of the day in halves, so that all the divisions are on 16 bits
+    uint32_t secondOfDay = ts.timestamp - ts.days() * secondsPerDay;
+    uint16_t halves = secondOfDay >> 1;
+    uint16_t rest = halves % 1800;
+
+    hours = halves / 1800;
+    minutes = rest / 30;
+    seconds = (rest % 30) * 2 + (secondOfDay & 1);
+}
+
+constexpr DateTime Timestamp::toDateTime() const { return DateTime(*this); }
+constexpr Timestamp DateTime::toTimestamp() const { return Timestamp(*this); }
+
+constexpr uint8_t DateTime::dayOfWeek() const {
+    return (__detail::days_from_civil(year, month, day) + 6) % 7;
+}
+
+constexpr uint16_t DateTime::dayOfYear() const {
+    return __detail::days_from_civil(year, month, day) - __detail::days_from_civil(year, 1, 1) + 1;
+}
 
 } // namespace avr
@@ -64,16 +64,59 @@ template <typename T> static constexpr bool is_enum_v = is_enum<T>::value;
 
 
 
+template <typename T> struct is_array { static constexpr bool value = false; };
+template <typename T, size_t N> struct is_array<T[N]> { static constexpr bool value = true; };
+template <typename T> static constexpr bool is_array_v = is_array<T>::value;
+
+
+
 template <typename T> struct is_trivially_copyable { static constexpr bool value = __is_trivially_copyable(T); };
 template <typename T> static constexpr bool is_trivially_copyable_v = is_trivially_copyable<T>::value;
 
 
 
+template <typename T> struct is_trivially_destructible { static constexpr bool value = __has_trivial_destructor(T); };
+template <typename T> static constexpr bool is_trivially_destructible_v = is_trivially_destructible<T>::value;
+
+
+
 template <typename T> struct underlying_type { using type = __underlying_type(T); };
 template <typename T> using underlying_type_t = typename underlying_type<T>::type;
 
 
 
+// Only the fixed width integer types are mapped
+template <typename T> struct make_unsigned;
+template <> struct make_unsigned<uint8_t>  { using type = uint8_t; };
+template <> struct make_unsigned<uint16_t> { using type = uint16_t; };
+template <> struct make_unsigned<uint32_t> { using type = uint32_t; };
+template <> struct make_unsigned<uint64_t> { using type = uint64_t; };
+template <> struct make_unsigned<int8_t>   { using type = uint8_t; };
+template <> struct make_unsigned<int16_t>  { using type = uint16_t; };
+template <> struct make_unsigned<int32_t>  { using type = uint32_t; };
+template <> struct make_unsigned<int64_t>  { using type = uint64_t; };
+template <typename T> using make_unsigned_t = typename make_unsigned<T>::type;
+
+
+
+template <typename T> struct is_integer { static constexpr bool value = false; };
+template <> struct is_integer<uint8_t>  { static constexpr bool value = true; };
+template <> struct is_integer<uint16_t> { static constexpr bool value = true; };
+template <> struct is_integer<uint32_t> { static constexpr bool value = true; };
+template <> struct is_integer<uint64_t> { static constexpr bool value = true; };
+template <> struct is_integer<int8_t>   { static constexpr bool value = true; };
+template <> struct is_integer<int16_t>  { static constexpr bool value = true; };
+template <> struct is_integer<int32_t>  { static constexpr bool value = true; };
+template <> struct is_integer<int64_t>  { static constexpr bool value = true; };
+template <typename T> static constexpr bool is_integer_v = is_integer<T>::value;
+
+
+
+template <typename T> struct is_signed { static constexpr bool value = T(-1) < T(0); };
+template <typename T> static constexpr bool is_signed_v = is_signed<T>::value;
+
+
+
 template <typename T>
 constexpr T&& forward(typename remove_reference<T>::type& x) noexcept {
     return static_cast<T&&>(x);
@@ -93,6 +136,15 @@ constexpr typename remove_reference<T>::type&& move(T&& x) noexcept {
 
 
 
+// Only usable in unevaluated contexts
+template <typename T> T&& declval() noexcept;
+
+
+
+template <typename...> using void_t = void;
+
+
+
 template <typename...>
 struct list;
 
@@ -101,9 +153,14 @@ struct list<Head, Rest...> {
     using head = Head;
     using tail = list<Rest...>;
 
+    static constexpr size_t size = 1 + sizeof...(Rest);
+
     template <typename T> using append = list<Head, Rest..., T>;
     template <typename T> using prepend = list<T, Head, Rest...>;
 
+    template <typename T> static constexpr bool contains = is_same_v<T, Head> || tail::template contains<T>;
+    template <typename T> using append_unique = conditional_t<contains<T>, list<Head, Rest...>, append<T>>;
+
     template <typename F>
     static inline void for_each(F&& f) {
         f(Head());
@@ -112,15 +169,27 @@ struct list<Head, Rest...> {
 };
 
 template <> struct list<> {
+    static constexpr size_t size = 0;
+
     template <typename T> using append = list<T>;
     template <typename T> using prepend = list<T>;
 
+    template <typename T> static constexpr bool contains = false;
+    template <typename T> using append_unique = list<T>;
+
     template <typename F>
     static inline void for_each(F&&) {}
 };
 
 
 
+template <size_t N, typename... Ts> struct type_at;
+template <typename T, typename... Ts> struct type_at<0, T, Ts...> { using type = T; };
+template <size_t N, typename T, typename... Ts> struct type_at<N, T, Ts...> { using type = typename type_at<N - 1, Ts...>::type; };
+template <size_t N, typename... Ts> using type_at_t = typename type_at<N, Ts...>::type;
+
+
+
 template <typename T, T... Ints> struct integer_sequence {
     using value_type = T;
     static constexpr size_t size() noexcept { return sizeof...(Ints); }
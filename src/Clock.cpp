@@ -1,5 +1,6 @@
 #include "avr-utils/Clock.hpp"
 #include "avr-utils/Timer.hpp"
+#include "avr-utils/Events.hpp"
 
 namespace avr {
 
@@ -22,8 +23,7 @@ void Clock::init() {
 
     // Enable Timer2 in Fast PWM mode with prescaler 64
     using T = Timer<2>;
-    T::setMode<TimerMode::FastPWM>();
-    T::setPrescaler<TimerPrescaler::By64>();
+    T::configure<TimerMode::FastPWM, TimerPrescaler::By64>();
     T::enableOverflowInterrupt();
 
     // Enable interrupts
@@ -53,4 +53,6 @@ ISR(TIMER2_OVF_vect) {
     Clock::_ms = ms;
     Clock::_msFraction = frac;
 
+    publish(events::ClockTick { ms });
+
 }
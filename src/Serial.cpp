@@ -1,4 +1,5 @@
 #include "avr-utils/Serial.hpp"
+#include "avr-utils/Events.hpp"
 
 namespace avr {
 
@@ -32,9 +33,11 @@ void HardwareSerial::stop() {
 void HardwareSerial::__doRxIRQ() {
     // Store the received byte in the buffer if no error has happened
     if ((*_ucsra & (1 << UPE0)) == 0) {
+        uint8_t c = *_udr;
         if (!_readBuffer.isFull()) {
-            _readBuffer.write(*_udr);
+            _readBuffer.write(c);
         }
+        publish(events::SerialReceived { *this, c });
     } else {
         *_udr; // Read and discard
     }
@@ -48,6 +51,7 @@ void HardwareSerial::__doTxIRQ() {
     // If we emptied the buffer, disable the interrupt
     if (_writeBuffer.isEmpty()) {
         *_ucsrb &= ~(1 << UDRIE0);
+        publish(events::SerialWriteBufferEmpty { *this });
     }
 }
 
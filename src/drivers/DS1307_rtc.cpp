@@ -37,7 +37,7 @@ void RTC::adjustNow(const DateTime& dt) const {
     I2C::write(bin2bcd(dt.seconds));
     I2C::write(bin2bcd(dt.minutes));
     I2C::write(bin2bcd(dt.hours));
-    I2C::write(bin2bcd(0));
+    I2C::write(bin2bcd(dt.dayOfWeek() + 1)); // From 1 to 7
     I2C::write(bin2bcd(dt.day));
     I2C::write(bin2bcd(dt.month));
     I2C::write(bin2bcd(dt.year - 2000));
@@ -56,4 +56,11 @@ bool RTC::isRunning() const {
     return (val & 0b10000000) == 0;
 }
 
+void RTC::enableSquareWave(bool enable) const {
+    I2C::start(_address, i2c::I2CDirection::Write);
+    I2C::write(7); // Control register
+    I2C::write(enable ? 0b00010000 : 0); // SQWE bit, with RS1 and RS0 cleared for 1Hz
+    I2C::stop();
+}
+
 } // namespace avr
\ No newline at end of file
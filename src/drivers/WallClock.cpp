@@ -0,0 +1,99 @@
+#include <util/atomic.h>
+
+#include "avr-utils/drivers/WallClock.hpp"
+
+namespace avr {
+
+const RTC* WallClock::_rtc = nullptr;
+uint32_t WallClock::_syncInterval = 0;
+uint32_t WallClock::_lastSync = 0;
+
+uint32_t WallClock::_seconds = 0;
+uint32_t WallClock::_heldSeconds = 0;
+uint64_t WallClock::_next = 0;
+uint32_t WallClock::_step = WallClock::nominalStep;
+
+uint64_t WallClock::_anchorMs = 0;
+uint32_t WallClock::_anchorSeconds = 0;
+
+void WallClock::init(const RTC& rtc, uint32_t syncInterval) {
+    _rtc = &rtc;
+    _syncInterval = syncInterval;
+
+    uint32_t t = Timestamp(rtc.now()).timestamp;
+    uint64_t ms = Clock::millis();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _seconds = t;
+        _heldSeconds = 0;
+        _next = (ms << 16) + _step;
+    }
+
+    _anchorMs = ms;
+    _anchorSeconds = t;
+    _lastSync = t;
+}
+
+void WallClock::sync() {
+    uint32_t t = Timestamp(_rtc->now()).timestamp;
+    uint64_t ms = Clock::millis();
+
+    // The RTC time is only accurate to the second, so the drift is measured over the whole time since the anchor
+    uint32_t elapsed = t - _anchorSeconds;
+    uint32_t step = _step;
+    if (t < _anchorSeconds) {
+        // The RTC has been adjusted backwards, measure again from now
+        _anchorMs = ms;
+        _anchorSeconds = t;
+    } else if (elapsed >= driftInterval) {
+        uint32_t measured = ((ms - _anchorMs) << 16) / elapsed;
+
+        // Tolerate a drift of 2%, more means that the RTC has been adjusted
+        if (measured > nominalStep - nominalStep / 50 && measured < nominalStep + nominalStep / 50) {
+            step = measured;
+        } else {
+            _anchorMs = ms;
+            _anchorSeconds = t;
+        }
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint64_t now = ms << 16;
+        advance(now);
+        _step = step;
+
+        if (t > _seconds) {
+            // Behind the RTC, jump forward
+            _seconds = t;
+            _heldSeconds = 0;
+            _next = now + step;
+        } else {
+            // Ahead of the RTC, stop until it catches up, whether the seconds are counted by advance() or tick()
+            _heldSeconds = _seconds - t;
+        }
+    }
+
+    _lastSync = t;
+}
+
+void WallClock::update() {
+    if (_syncInterval != 0 && now().timestamp - _lastSync >= _syncInterval) {
+        sync();
+    }
+}
+
+void WallClock::tick() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint64_t now = Clock::millis() << 16;
+        advance(now);
+
+        // The tick is either the boundary that has just been counted, or the next one, which is early
+        if (_next - now < _step / 2) {
+            count(1);
+        }
+
+        _next = now + _step;
+    }
+}
+
+} // namespace avr
@@ -0,0 +1,108 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "avr-utils/eeprom.hpp"
+
+namespace avr {
+
+static_assert(EEPROM_WRITE_QUEUE_SIZE >= 1 && EEPROM_WRITE_QUEUE_SIZE <= 255, "Invalid EEPROM write queue size.");
+
+uint16_t EEPROMWriter::_addresses[EEPROM_WRITE_QUEUE_SIZE];
+uint8_t EEPROMWriter::_values[EEPROM_WRITE_QUEUE_SIZE];
+volatile uint8_t EEPROMWriter::_head = 0;
+volatile uint8_t EEPROMWriter::_count = 0;
+
+void EEPROMWriter::write(void* address, uint8_t value) {
+    if (SREG & (1 << SREG_I)) {
+        while (_count == EEPROM_WRITE_QUEUE_SIZE) ;
+    } else {
+        while (_count == EEPROM_WRITE_QUEUE_SIZE) {
+            while (EECR & (1 << EEPE)) ;
+            writeNext();
+        }
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t tail = _head + _count;
+        if (tail >= EEPROM_WRITE_QUEUE_SIZE) {
+            tail -= EEPROM_WRITE_QUEUE_SIZE;
+        }
+
+        _addresses[tail] = (uint16_t) (uintptr_t) address;
+        _values[tail] = value;
+        _count = _count + 1;
+
+        // The interrupt fires as soon as the EEPROM is ready
+        EECR |= (1 << EERIE);
+    }
+}
+
+void EEPROMWriter::write(void* address, const void* data, size_t size) {
+    uint8_t* dst = (uint8_t*) address;
+    const uint8_t* src = (const uint8_t*) data;
+    for (size_t i = 0; i < size; ++i) {
+        write(dst + i, src[i]);
+    }
+}
+
+bool EEPROMWriter::busy() {
+    return _count != 0 || (EECR & (1 << EEPE));
+}
+
+void EEPROMWriter::drain() {
+    while (busy()) ;
+}
+
+void EEPROMWriter::writeNext() {
+    uint8_t head = _head;
+    uint8_t count = _count;
+
+    // Skip the bytes that already have the right value, to save both time and wear
+    while (count > 0) {
+        uint16_t address = _addresses[head];
+        uint8_t value = _values[head];
+
+        head = head == EEPROM_WRITE_QUEUE_SIZE - 1 ? 0 : head + 1;
+        count--;
+
+        EEAR = address;
+        EECR |= (1 << EERE);
+        uint8_t old = EEDR;
+
+        if (old != value) {
+            // Erasing or writing alone takes half the time of an atomic erase and write
+            uint8_t mode;
+            if (value == 0xFF) {
+                mode = (1 << EEPM0);
+            } else if ((value & ~old) == 0) {
+                mode = (1 << EEPM1);
+            } else {
+                mode = 0;
+            }
+
+            EEDR = value;
+            EECR = mode | (1 << EERIE) | (1 << EEMPE);
+            EECR |= (1 << EEPE);
+            break;
+        }
+    }
+
+    _head = head;
+    _count = count;
+
+    // Once the queue is empty, stop the interrupt after the last write,
+    // and restore the default programming mode for the blocking functions of avr-libc
+    if (count == 0 && !(EECR & (1 << EEPE))) {
+        EECR = 0;
+    }
+}
+
+} // namespace avr
+
+
+
+ISR(EE_READY_vect)
+{
+    avr::EEPROMWriter::writeNext();
+}
@@ -3,20 +3,27 @@
 #include <util/atomic.h>
 
 #include "avr-utils/i2c_slave.hpp"
+#include "avr-utils/Events.hpp"
 
 namespace avr {
 namespace i2c {
 
-// Callback pointers
-void (*Slave::__onDataReceived)(uint8_t) = nullptr;
-uint8_t (*Slave::__onDataRequested)() = nullptr;
+// Callbacks
+Slave::DataReceivedCallback Slave::__onDataReceived;
+Slave::DataRequestedCallback Slave::__onDataRequested;
 
-void Slave::onDataReceived(void (*f)(uint8_t)) {
-    __onDataReceived = f;
+// The callbacks span several bytes, so they must not be read by the interrupt while they are being replaced
+
+void Slave::onDataReceived(DataReceivedCallback f) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        __onDataReceived = f;
+    }
 }
 
-void Slave::onDataRequested(uint8_t (*f)()) {
-    __onDataRequested = f;
+void Slave::onDataRequested(DataRequestedCallback f) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        __onDataRequested = f;
+    }
 }
 
 void Slave::init(uint8_t address) {
@@ -46,25 +53,33 @@ void Slave::stop() {
 
 ISR(TWI_vect)
 {
+    using namespace avr;
     using namespace avr::i2c;
 
     switch(TW_STATUS)
     {
-        case TW_SR_DATA_ACK:
-            // Received data from master, call the receive callback
+        case TW_SR_DATA_ACK: {
+            // Received data from master, call the receive callback and the subscribers
+            uint8_t data = TWDR;
             if (Slave::__onDataReceived) {
-                Slave::__onDataReceived(TWDR);
+                Slave::__onDataReceived(data);
             }
+            publish(events::I2CDataReceived { data });
             TWCR = (1 << TWIE) | (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
             break;
+        }
         case TW_ST_SLA_ACK:
-        case TW_ST_DATA_ACK:
-            // Master is requesting data, call the request callback
+        case TW_ST_DATA_ACK: {
+            // Master is requesting data, call the request callback and then the subscribers, which can override it
+            uint8_t data = TWDR;
             if (Slave::__onDataRequested) {
-                TWDR = Slave::__onDataRequested();
+                data = Slave::__onDataRequested();
             }
+            publish(events::I2CDataRequested { data });
+            TWDR = data;
             TWCR = (1 << TWIE) | (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
             break;
+        }
         case TW_BUS_ERROR:
             // Some sort of erroneous state, prepare TWI to be readdressed
             TWCR = 0;
@@ -0,0 +1,31 @@
+#include "avr-utils/spi.hpp"
+
+namespace avr {
+namespace spi {
+
+void Master::transfer(uint8_t* data, uint16_t length) {
+    for (uint16_t i = 0; i < length; ++i) {
+        data[i] = transfer(data[i]);
+    }
+}
+
+void Master::write(const uint8_t* data, uint16_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    SPDR = *data;
+    while (--length) {
+
+        // Fetch the next byte while the current one is being shifted out,
+        // so that the bus stays idle only for the few cycles needed to reload the data register
+        uint8_t next = *++data;
+        while (!(SPSR & (1 << SPIF)));
+        SPDR = next;
+
+    }
+    while (!(SPSR & (1 << SPIF)));
+}
+
+} // namespace spi
+} // namespace avr